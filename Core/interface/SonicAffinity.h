@@ -0,0 +1,122 @@
+#ifndef SonicCMS_Core_SonicAffinity
+#define SonicCMS_Core_SonicAffinity
+
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+//placement of SONIC helper threads and tensor buffers on multi-socket nodes, configured by SonicAffinityService (off by default):
+//	helper threads (pseudo-async threads, client library callback threads, logging and introspection threads) can be pinned to a set of CPUs
+//	the client buffers of each stream can be allocated on a NUMA node (stream i uses bufferNodes[i % size]) with SonicNumaAllocator
+//	optionally, the bytes that producers write (input) and read (output) on a thread of another node than the buffer are counted as cross-node traffic
+//uses the Linux system calls directly (no libnuma dependency); failures are not fatal
+class SonicAffinity {
+	public:
+		struct Config {
+			std::vector<unsigned> helperCpus;
+			std::vector<int> bufferNodes;
+			bool report = false;
+		};
+
+		static SonicAffinity& instance();
+
+		void configure(const Config& config);
+		bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+		//pin the calling helper thread (once per thread; no-op if no CPUs are configured)
+		void pinHelperThread();
+
+		//home node of a stream (-1 = none)
+		int bufferNode(unsigned stream) const;
+		bool report() const { return enabled() and config_.report; }
+
+		//node of the calling thread, and of the page containing ptr (-1 if unknown)
+		static int currentNode();
+		static int nodeOf(const void* ptr);
+		//page-aligned anonymous mapping whose pages will be allocated on node when they are first touched (node < 0: no policy)
+		static void* allocate(size_t bytes, int node);
+		static void deallocate(void* ptr, size_t bytes);
+
+	private:
+		SonicAffinity() : enabled_(false) {}
+
+		Config config_;
+		std::atomic<bool> enabled_;
+};
+
+//allocator for client buffers: each allocation is a separate mapping, so the memory policy only covers the buffer itself,
+//and it is set before the pages are first touched (no migration); the node is read from the owning client at allocation time
+//(SonicClientTypes::setBufferNode(), called at beginStream)
+//a default-constructed allocator (e.g. for temporaries) uses std::allocator; the two kinds never exchange storage,
+//so assigning a temporary to a client buffer copies the elements into the buffer's own pages
+template <typename T>
+class SonicNumaAllocator {
+	public:
+		typedef T value_type;
+		SonicNumaAllocator() : node_(nullptr) {}
+		explicit SonicNumaAllocator(const int* node) : node_(node) {}
+		template <typename U>
+		SonicNumaAllocator(const SonicNumaAllocator<U>& other) : node_(other.node()) {}
+
+		T* allocate(size_t n) {
+			if(!node_) return std::allocator<T>().allocate(n);
+			return static_cast<T*>(SonicAffinity::allocate(n*sizeof(T), *node_));
+		}
+		void deallocate(T* ptr, size_t n) {
+			if(!node_) std::allocator<T>().deallocate(ptr, n);
+			else SonicAffinity::deallocate(ptr, n*sizeof(T));
+		}
+
+		const int* node() const { return node_; }
+
+	private:
+		const int* node_;
+};
+template <typename T, typename U>
+bool operator==(const SonicNumaAllocator<T>& a, const SonicNumaAllocator<U>& b) { return (a.node() == nullptr) == (b.node() == nullptr); }
+template <typename T, typename U>
+bool operator!=(const SonicNumaAllocator<T>& a, const SonicNumaAllocator<U>& b) { return !(a == b); }
+
+template <typename T>
+using SonicNumaVector = std::vector<T, SonicNumaAllocator<T>>;
+
+namespace sonic_affinity {
+	//client buffer that allocates on the node stored in *node (other buffer types are default-constructed)
+	template <typename T>
+	struct Buffer {
+		static T make(const int*) { return T(); }
+	};
+	template <typename T>
+	struct Buffer<SonicNumaVector<T>> {
+		static SonicNumaVector<T> make(const int* node) { return SonicNumaVector<T>(SonicNumaAllocator<T>(node)); }
+	};
+}
+
+//buffers of one producer (per stream): counts local and cross-node bytes (if SonicAffinity::report() is set)
+class SonicBufferPlacement {
+	public:
+		void bind(const std::string& module);
+		bool bound() const { return local_[0] != nullptr; }
+
+		enum Direction { Write, Read };
+		//region of a buffer that was written (acquire) or read (produce) on the calling thread
+		void access(Direction direction, const void* data, size_t bytes);
+
+		template <typename T, typename A>
+		void access(Direction direction, const std::vector<T,A>& v) { access(direction, v.data(), v.capacity()*sizeof(T)); }
+		//sharded clients: one buffer per shard
+		template <typename T>
+		void access(Direction direction, const std::vector<T*>& v) { for(const auto* p : v) access(direction, *p); }
+		template <typename T>
+		void access(Direction direction, const T&) {}
+
+	private:
+		SonicCounter* local_[2] = {};
+		SonicCounter* remote_[2] = {};
+};
+
+#endif
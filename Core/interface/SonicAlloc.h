@@ -0,0 +1,41 @@
+#ifndef SonicCMS_Core_SonicAlloc
+#define SonicCMS_Core_SonicAlloc
+
+#include <cstdint>
+
+//allocation counting for hot-path stages (instrumentation mode)
+//the separate library libSonicCMSCoreAllocHooks provides replacements for the global operator new/new[] that count allocations and bytes per thread;
+//no other library links it, so they are only used if it is preloaded, e.g.:
+//	LD_PRELOAD=$CMSSW_BASE/lib/$SCRAM_ARCH/libSonicCMSCoreAllocHooks.so cmsRun ...
+//otherwise the counters stay at zero and enabled() is false
+//scopes only see allocations on their own thread, so stages that run on other threads (e.g. async callbacks) are not counted
+
+struct SonicAllocStats {
+	uint64_t count = 0;
+	uint64_t bytes = 0;
+};
+
+namespace sonic_alloc {
+	//true if the replacement operators were preloaded
+	bool enabled();
+	//running totals for the current thread
+	SonicAllocStats current();
+}
+
+//allocations on this thread since construction
+class SonicAllocScope {
+	public:
+		SonicAllocScope() : start_(sonic_alloc::current()) {}
+		SonicAllocStats stats() const {
+			const SonicAllocStats now(sonic_alloc::current());
+			SonicAllocStats result;
+			result.count = now.count - start_.count;
+			result.bytes = now.bytes - start_.bytes;
+			return result;
+		}
+
+	private:
+		SonicAllocStats start_;
+};
+
+#endif
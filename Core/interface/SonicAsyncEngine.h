@@ -0,0 +1,78 @@
+#ifndef SonicCMS_Core_SonicAsyncEngine
+#define SonicCMS_Core_SonicAsyncEngine
+
+#include "SonicCMS/Core/interface/SonicAffinity.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//one outstanding operation: its address is the tag given to the completion queue
+class SonicAsyncCall {
+	public:
+		virtual ~SonicAsyncCall() {}
+		//called on an engine thread when the operation finishes (ok = false if it failed or the queue was shut down)
+		virtual void complete(bool ok) = 0;
+};
+
+//number of polling threads for each engine, set by SonicAsyncService before the first client uses an engine
+namespace sonic_async {
+	unsigned threads();
+	void setThreads(unsigned n);
+}
+
+//process-wide pool of completion-queue polling threads, shared by all clients of one protocol (instead of one worker per client)
+//Queue must provide bool Next(void** tag, bool* ok) and void Shutdown(), as grpc::CompletionQueue does
+//each thread polls its own queue, calls are spread over the queues round robin, and dispatch is one virtual call on the tag,
+//so the number of threads is fixed however many streams, modules, and outstanding requests there are
+//the completion should only store the result and hand the rest to the framework (see SonicClientBase::complete())
+template <typename Queue>
+class SonicAsyncEngine {
+	public:
+		static SonicAsyncEngine& instance() {
+			static SonicAsyncEngine engine;
+			return engine;
+		}
+
+		//queue for the next call (the call must then be started on it)
+		Queue& queue() {
+			outstanding_->inc();
+			return *queues_[next_.fetch_add(1, std::memory_order_relaxed) % queues_.size()];
+		}
+		unsigned threads() const { return threads_.size(); }
+
+		//outstanding calls are completed with ok = false before the threads exit
+		~SonicAsyncEngine() {
+			for(auto& queue : queues_) queue->Shutdown();
+			for(auto& thread : threads_) thread.join();
+		}
+
+	private:
+		SonicAsyncEngine() : next_(0) {
+			auto& registry = SonicMetrics::instance();
+			outstanding_ = &registry.gauge("sonic_async_outstanding_calls", "calls started on the shared completion engine and not yet completed", {});
+			const unsigned n = sonic_async::threads();
+			registry.gauge("sonic_async_threads", "completion threads of the shared completion engine", {}).inc(n);
+			for(unsigned i = 0; i < n; ++i) queues_.push_back(std::make_unique<Queue>());
+			for(unsigned i = 0; i < n; ++i) threads_.emplace_back(&SonicAsyncEngine::poll, this, queues_[i].get());
+		}
+
+		void poll(Queue* queue) {
+			SonicAffinity::instance().pinHelperThread();
+			void* tag;
+			bool ok;
+			while(queue->Next(&tag, &ok)){
+				outstanding_->dec();
+				static_cast<SonicAsyncCall*>(tag)->complete(ok);
+			}
+		}
+
+		std::vector<std::unique_ptr<Queue>> queues_;
+		std::vector<std::thread> threads_;
+		std::atomic<unsigned> next_;
+		SonicGauge* outstanding_;
+};
+
+#endif
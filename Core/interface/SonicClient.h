@@ -0,0 +1,80 @@
+#ifndef SonicCMS_Core_SonicClient
+#define SonicCMS_Core_SonicClient
+
+#include "FWCore/Concurrency/interface/WaitingTaskWithArenaHolder.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "SonicCMS/Core/interface/SonicClientBase.h"
+#include "SonicCMS/Core/interface/SonicClientTypes.h"
+#include "SonicCMS/Core/interface/SonicWorkerThread.h"
+
+#include <exception>
+#include <memory>
+#include <string>
+
+enum class SonicMode { Sync, Async, PseudoAsync };
+
+//mode from the "mode" client parameter (Sync, Async, PseudoAsync; default Async)
+inline SonicMode sonicMode(const edm::ParameterSet& params) {
+	const std::string name(params.existsAs<std::string>("mode") ? params.getParameter<std::string>("mode") : "Async");
+	if(name == "Sync") return SonicMode::Sync;
+	else if(name == "Async") return SonicMode::Async;
+	else if(name == "PseudoAsync") return SonicMode::PseudoAsync;
+	else throw cms::Exception("Configuration") << "unknown client mode " << name << " (allowed: Sync, Async, PseudoAsync)";
+}
+
+//the mode is chosen at runtime, so a concrete client is compiled once and a producer needs only one plugin:
+//	Sync: predictImpl() blocks, then finish() is called
+//	PseudoAsync: the blocking predictImpl() runs in a separate std::thread (only created in this mode), then finish() is called there
+//	Async: predictImpl() sends the request and returns; finish() is called when the response arrives
+//predictImpl() checks mode() to choose between the blocking and the non-blocking call;
+//the dispatch is one branch per request, next to the virtual call to predictImpl() that all modes already have
+template <typename InputT, typename OutputT=InputT>
+class SonicClient : public SonicClientBase, public SonicClientTypes<InputT,OutputT> {
+	public:
+		//constructor
+		SonicClient(const edm::ParameterSet& params) : SonicClientBase(), SonicClientTypes<InputT,OutputT>(), mode_(sonicMode(params)) {
+			if(mode_ == SonicMode::PseudoAsync) worker_ = std::make_unique<SonicWorkerThread>();
+		}
+		//destructor
+		virtual ~SonicClient() {}
+
+		SonicMode mode() const { return mode_; }
+
+		//main operation
+		void predict(edm::WaitingTaskWithArenaHolder holder) override final {
+			if(mode_ == SonicMode::PseudoAsync){
+				//activate the thread to wait for the response, and return
+				//(the holder is set inside the lock: the previous call may still be releasing it)
+				worker_->submit([this](){ run(); }, [&](){
+					holder_ = std::move(holder);
+					setStartTime();
+				});
+				return;
+			}
+			holder_ = std::move(holder);
+			setStartTime();
+			if(mode_ == SonicMode::Sync) run();
+			//impl calls finish() which calls holder_
+			else predictImpl();
+		}
+
+	private:
+		//blocking call, then finish
+		void run() {
+			std::exception_ptr eptr;
+			try {
+				predictImpl();
+			}
+			catch(...) {
+				eptr = std::current_exception();
+			}
+			finish(eptr);
+		}
+
+		//members
+		SonicMode mode_;
+		std::unique_ptr<SonicWorkerThread> worker_;
+};
+
+#endif
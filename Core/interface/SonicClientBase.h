@@ -1,29 +1,96 @@
 #ifndef SonicCMS_Core_SonicClientBase
 #define SonicCMS_Core_SonicClientBase
 
+#include "FWCore/Concurrency/interface/WaitingTask.h"
 #include "FWCore/Concurrency/interface/WaitingTaskWithArenaHolder.h"
+#include "SonicCMS/Core/interface/SonicInflight.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+#include "SonicCMS/Core/interface/SonicTracer.h"
+#include "SonicCMS/Core/interface/SonicProbes.h"
 
 #include <string>
 #include <chrono>
 #include <exception>
+#include <functional>
+#include <future>
+#include <utility>
+
+//server-side time of one request, if the client can obtain it (for external-work accounting)
+struct SonicServerTime {
+	bool valid = false;
+	double queueUs = 0;
+	double computeUs = 0;
+};
 
 class SonicClientBase {
 	public:
 		//destructor
-		virtual ~SonicClientBase() {}
+		virtual ~SonicClientBase() {
+			if(inflight_) SonicInflight::instance().remove(inflight_);
+		}
 
 		void setDebugName(const std::string& debugName) { debugName_ = debugName; }
 
 		//main operation
 		virtual void predict(edm::WaitingTaskWithArenaHolder holder) = 0;
 
+		//expensive setup (connections, model metadata) that does not need an event:
+		//started by the producer at beginStream, so all streams and modules initialize concurrently instead of on their first event
+		void initialize() {
+			if(initStarted_) return;
+			initStarted_ = true;
+			//bound here, before other threads can use the metrics
+			SonicClientMetrics& m = metrics();
+			init_ = std::async(std::launch::async, [this, &m](){
+				const auto t0 = std::chrono::high_resolution_clock::now();
+				initializeImpl();
+				m.initialized(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t0).count());
+			});
+		}
+		//called by the concrete client before its first request (runs initializeImpl() if initialize() was not called); rethrows its exception once
+		void waitInitialized() {
+			initialize();
+			if(init_.valid()) init_.get();
+		}
+
+		//event for the next request (for tracing), called by the producer before predict()
+		void setTraceContext(unsigned stream, uint64_t event) {
+			trace_.stream = stream;
+			trace_.event = event;
+			++trace_.request;
+		}
+		const SonicTraceContext& traceContext() const { return trace_; }
+
+		//server-side time of the last request (not valid if the client does not collect it)
+		const SonicServerTime& serverTime() const { return serverTime_; }
+
+		//metrics are labeled with the debug name and the endpoint (bound on first use)
+		SonicClientMetrics& metrics() {
+			if(!metrics_.bound()) metrics_.bind(debugName_.empty() ? "unknown" : debugName_, endpoint_.empty() ? "unknown" : endpoint_);
+			return metrics_;
+		}
+
+		//introspection entry for this client (registered on first use)
+		SonicInflight::Entry& inflight() {
+			if(!inflight_) inflight_ = SonicInflight::instance().add(debugName_.empty() ? "unknown" : debugName_, endpoint_.empty() ? "unknown" : endpoint_);
+			return *inflight_;
+		}
+
 	protected:
 		virtual void predictImpl() = 0;
+		//runs on a separate thread; must not use the input or output
+		virtual void initializeImpl() {}
+		//concrete clients that implement initializeImpl() must call this in their destructor
+		void joinInitialize() {
+			if(init_.valid()) init_.wait();
+		}
 
 		void setStartTime() {
-			if(debugName_.empty()) return;
 			t0_ = std::chrono::high_resolution_clock::now();
 			setTime_ = true;
+			serverTime_ = SonicServerTime();
+			metrics().start();
+			inflight().begin(trace_);
 		}
 
 		void finish(std::exception_ptr eptr = std::exception_ptr{}) {
@@ -32,16 +99,71 @@ class SonicClientBase {
 				auto t1 = std::chrono::high_resolution_clock::now();
 				clientTime = (unsigned int)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0_).count();
 			}*/
+			//record before releasing the holder, after which produce() may run
+			if(setTime_){
+				auto t1 = std::chrono::high_resolution_clock::now();
+				metrics().stop(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0_).count(), bool(eptr));
+				SonicTracer::instance().span("request", "sonic", SonicTracer::requestTrack(trace_.stream), t0_, t1, trace_, debugName_);
+				setTime_ = false;
+			}
+			SONIC_PROBE(finish, debugName_.c_str(), trace_.stream, 0, 0);
+			inflight().end();
 			holder_.doneWaiting(eptr);
 		}
 
+		//for asynchronous requests: completion work (decoding, bookkeeping, finish()) should not run on the client library's callback thread,
+		//which would serialize all completions behind it: predictImpl() registers the work before sending the request
+		//(it must be called on the framework thread, to capture the TBB arena), and the callback only stores the response
+		//and calls complete(), which enqueues the work as a task in the arena
+		void deferCompletion(std::function<void()> work) {
+			work_ = std::move(work);
+			auto task = edm::make_waiting_task(tbb::task::allocate_root(), [this](std::exception_ptr const* eptr){
+				if(eptr){
+					finish(*eptr);
+					return;
+				}
+				//moved out first: finish() lets the next request register its own work while this one returns
+				auto work(std::move(work_));
+				try {
+					work();
+				}
+				catch(...) {
+					finish(std::current_exception());
+				}
+			});
+			completion_ = edm::WaitingTaskWithArenaHolder(task);
+		}
+		//call from the callback thread with the time it was entered (the time spent there is recorded as the callback stage)
+		void complete(std::chrono::high_resolution_clock::time_point entered, std::exception_ptr eptr = std::exception_ptr{}) {
+			metrics().observe(SonicClientMetrics::Callback,
+				std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - entered).count());
+			//moved out first: the task may already be running (and registering the next request) when doneWaiting() returns
+			edm::WaitingTaskWithArenaHolder completion(std::move(completion_));
+			completion.doneWaiting(eptr);
+		}
+		//if the request could not be sent (the work is not run, and finish() is called with the exception)
+		void cancelCompletion(std::exception_ptr eptr) {
+			edm::WaitingTaskWithArenaHolder completion(std::move(completion_));
+			completion.doneWaiting(eptr);
+		}
+
 		//members
 		edm::WaitingTaskWithArenaHolder holder_;
 
 		//for logging/debugging
 		std::string debugName_;
+		//server address, set by concrete clients
+		std::string endpoint_;
+		SonicClientMetrics metrics_;
+		SonicInflight::Entry* inflight_ = nullptr;
+		SonicTraceContext trace_;
+		SonicServerTime serverTime_;
 		std::chrono::time_point<std::chrono::high_resolution_clock> t0_;
 		bool setTime_ = false;
+		bool initStarted_ = false;
+		std::future<void> init_;
+		std::function<void()> work_;
+		edm::WaitingTaskWithArenaHolder completion_;
 };
 
 #endif
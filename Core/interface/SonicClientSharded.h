@@ -0,0 +1,107 @@
+#ifndef SonicCMS_Core_SonicClientSharded
+#define SonicCMS_Core_SonicClientSharded
+
+#include "FWCore/Concurrency/interface/WaitingTaskWithArenaHolder.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "SonicCMS/Core/interface/SonicClient.h"
+#include "SonicCMS/Core/interface/SonicClientBase.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+#include "SonicCMS/Core/interface/SonicTracer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+//splits one request into several independent requests (shards), each with its own client
+//(e.g. to send different parts of the input to different models or servers)
+//all shards are issued together, and the producer continues once the last one is done
+template <typename Client>
+class SonicClientSharded {
+	public:
+		//typedefs for outside accessibility: one buffer per shard, owned by the shard clients
+		typedef std::vector<typename Client::Input*> Input;
+		typedef std::vector<const typename Client::Output*> Output;
+
+		//constructor: each entry in "shards" is a complete parameter set for the concrete client
+		//(Sync mode is rejected: predict() would block on each shard in turn, so the shards would not overlap)
+		SonicClientSharded(const edm::ParameterSet& params) {
+			for(const auto& shardParams : params.getParameter<std::vector<edm::ParameterSet>>("shards")){
+				shards_.push_back(std::make_unique<Client>(shardParams));
+				if(shards_.back()->mode() == SonicMode::Sync)
+					throw cms::Exception("Configuration") << "shard " << shards_.size()-1 << " uses Sync mode, which would send the shards one after another (use Async or PseudoAsync)";
+				input_.push_back(&shards_.back()->input());
+				output_.push_back(&shards_.back()->output());
+			}
+		}
+
+		void setDebugName(const std::string& debugName) {
+			debugName_ = debugName;
+			for(unsigned i = 0; i < shards_.size(); ++i){
+				shards_[i]->setDebugName(debugName + "_shard" + std::to_string(i));
+			}
+		}
+
+		void setTraceContext(unsigned stream, uint64_t event) {
+			trace_.stream = stream;
+			trace_.event = event;
+			++trace_.request;
+			for(auto& shard : shards_){
+				shard->setTraceContext(stream, event);
+			}
+		}
+		const SonicTraceContext& traceContext() const { return trace_; }
+
+		//the shards run in parallel, so the slowest one (of those that report server time) determines the wait
+		SonicServerTime serverTime() const {
+			SonicServerTime result;
+			for(const auto& shard : shards_){
+				const auto& st = shard->serverTime();
+				if(st.valid and (!result.valid or st.queueUs + st.computeUs > result.queueUs + result.computeUs)) result = st;
+			}
+			return result;
+		}
+
+		void setBufferNode(int node) {
+			for(auto& shard : shards_){
+				shard->setBufferNode(node);
+			}
+		}
+
+		//the shards initialize concurrently
+		void initialize() {
+			for(auto& shard : shards_){
+				shard->initialize();
+			}
+		}
+
+		//main operation: each shard holds a copy of the holder, so the waiting task runs after all have finished
+		void predict(edm::WaitingTaskWithArenaHolder holder) {
+			for(auto& shard : shards_){
+				shard->predict(holder);
+			}
+		}
+
+		//accessors
+		Input& input() { return input_; }
+		const Input& input() const { return input_; }
+		const Output& output() const { return output_; }
+		unsigned nshards() const { return shards_.size(); }
+		//producer-level stages; each shard also has its own client metrics
+		SonicClientMetrics& metrics() {
+			if(!metrics_.bound()) metrics_.bind(debugName_.empty() ? "unknown" : debugName_, "shards");
+			return metrics_;
+		}
+		Client& shard(unsigned i) { return *shards_[i]; }
+		const Client& shard(unsigned i) const { return *shards_[i]; }
+
+	protected:
+		std::vector<std::unique_ptr<Client>> shards_;
+		Input input_;
+		Output output_;
+		std::string debugName_;
+		SonicClientMetrics metrics_;
+		SonicTraceContext trace_;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define SonicCMS_Core_SonicClientTypes
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "SonicCMS/Core/interface/SonicAffinity.h"
 
 //this base class exists to limit the impact of dependent scope in derived classes
 template <typename InputT, typename OutputT=InputT>
@@ -18,10 +19,13 @@ class SonicClientTypes {
 		const Input& input() const { return input_; }
 		void setInput(const Input& inp) { input_ = inp; }
 		const Output& output() const { return output_; }
+		//NUMA node for buffers allocated from now on (-1 = none); only used by buffer types with SonicNumaAllocator
+		void setBufferNode(int node) { bufferNode_ = node; }
 
 	protected:
-		Input input_;
-		Output output_;
+		int bufferNode_ = -1;
+		Input input_ = sonic_affinity::Buffer<Input>::make(&bufferNode_);
+		Output output_ = sonic_affinity::Buffer<Output>::make(&bufferNode_);
 };
 
 #endif
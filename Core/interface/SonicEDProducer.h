@@ -7,6 +7,12 @@
 #include "FWCore/Framework/interface/EventSetup.h"
 #include "FWCore/Concurrency/interface/WaitingTaskWithArenaHolder.h"
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "SonicCMS/Core/interface/SonicAffinity.h"
+#include "SonicCMS/Core/interface/SonicAlloc.h"
+#include "SonicCMS/Core/interface/SonicMemory.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+#include "SonicCMS/Core/interface/SonicTracer.h"
+#include "SonicCMS/Core/interface/SonicProbes.h"
 #include <sstream>
 #include <string>
 #include <chrono>
@@ -45,23 +51,70 @@ class SonicEDProducer : public edm::stream::EDProducer<edm::ExternalWork, Capabi
             file.close();*/
         }
 		
+		//start the client initialization; streams are begun one after the other, so the clients of all streams and modules initialize concurrently
+		//the client buffers of the stream are allocated on its NUMA node from then on (if configured in SonicAffinityService)
+		//(derived classes that override beginStream() should call this)
+		void beginStream(edm::StreamID id) override {
+			client_.setBufferNode(SonicAffinity::instance().bufferNode(id.value()));
+			client_.initialize();
+		}
+
 		//derived classes use a dedicated acquire() interface that incorporates client_.input()
 		//(no need to interact with callback holder)
 		void acquire(edm::Event const& iEvent, edm::EventSetup const& iSetup, edm::WaitingTaskWithArenaHolder holder) override final {
+			const unsigned stream = iEvent.streamID().value();
+			client_.setTraceContext(stream, iEvent.id().event());
+			SONIC_PROBE(acquire__entry, debugName_.c_str(), stream, 0, 0);
 			auto t0 = std::chrono::high_resolution_clock::now();
+			SonicAllocScope allocScope;
 			acquire(iEvent, iSetup, client_.input());
+			const SonicAllocStats allocStats(allocScope.stats());
 			auto t1 = std::chrono::high_resolution_clock::now();
+			SONIC_PROBE(acquire__exit, debugName_.c_str(), stream, sonic_probes::batchSize(client_), sonic_probes::bytes(client_.input()));
+			if(!memInput_.bound()){
+				const std::string module(debugName_.empty() ? "unknown" : debugName_);
+				memInput_.bind(module, stream, "input");
+				memOutput_.bind(module, stream, "output");
+				memProducer_.bind(module, stream, "producer");
+			}
+			memInput_.set(sonic_memory::bytes(client_.input()));
+			if(SonicAffinity::instance().report()){
+				if(!placement_.bound()) placement_.bind(debugName_.empty() ? "unknown" : debugName_);
+				placement_.access(SonicBufferPlacement::Write, client_.input());
+			}
+			const auto acquireTime = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
 			if(!debugName_.empty()) {
-               sumLoadTime += (unsigned int)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+               sumLoadTime += (unsigned int)acquireTime;
                numLoadTime++;
             }
+			client_.metrics().observe(SonicClientMetrics::Acquire, acquireTime);
+			client_.metrics().allocated(SonicClientMetrics::Acquire, allocStats);
+			SonicTracer::instance().span("acquire", "sonic", SonicTracer::threadTrack(), t0, t1, client_.traceContext(), debugName_);
+			//set before predict(), since produce() may already run when it returns
+			tPredict_ = std::chrono::high_resolution_clock::now();
+			SONIC_PROBE(predict, debugName_.c_str(), stream, sonic_probes::batchSize(client_), sonic_probes::bytes(client_.input()));
 			client_.predict(holder);
 		}
 		virtual void acquire(edm::Event const& iEvent, edm::EventSetup const& iSetup, Input& iInput) = 0;
 		//derived classes use a dedicated produce() interface that incorporates client_.output()
 		void produce(edm::Event& iEvent, edm::EventSetup const& iSetup) override final {
-			//todo: measure time between acquire and produce
+			//time between the request being sent and produce() being called
+			const unsigned stream = iEvent.streamID().value();
+			SONIC_PROBE(produce__entry, debugName_.c_str(), stream, sonic_probes::batchSize(client_), sonic_probes::bytes(client_.output()));
+			auto t0 = std::chrono::high_resolution_clock::now();
+			const auto waitTime = std::chrono::duration_cast<std::chrono::microseconds>(t0 - tPredict_).count();
+			client_.metrics().observe(SonicClientMetrics::Wait, waitTime);
+			recordExternal(waitTime);
+			SonicAllocScope allocScope;
 			produce(iEvent, iSetup, client_.output());
+			if(placement_.bound()) placement_.access(SonicBufferPlacement::Read, client_.output());
+			const SonicAllocStats allocStats(allocScope.stats());
+			auto t1 = std::chrono::high_resolution_clock::now();
+			client_.metrics().observe(SonicClientMetrics::Produce, std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+			client_.metrics().allocated(SonicClientMetrics::Produce, allocStats);
+			memOutput_.set(sonic_memory::bytes(client_.output()));
+			SONIC_PROBE(produce__exit, debugName_.c_str(), stream, 0, 0);
+			SonicTracer::instance().span("produce", "sonic", SonicTracer::threadTrack(), t0, t1, client_.traceContext(), debugName_);
 		}
 		virtual void produce(edm::Event& iEvent, edm::EventSetup const& iSetup, Output const& iOutput) = 0;
 		
@@ -71,14 +124,40 @@ class SonicEDProducer : public edm::stream::EDProducer<edm::ExternalWork, Capabi
 			debugName_ = debugName;
 			client_.setDebugName(debugName);
 		}
+		//bytes kept by the derived producer between events (call from produce())
+		void setProducerMemory(uint64_t bytes) { memProducer_.set(bytes); }
 		//members
 		Client client_;
 		std::string debugName_;
 
     private:
+		//external work per module label (the asynchronous wait between acquire() and produce(), which the framework does not see),
+		//with the server-side part when the client reports it; summarized per module and path by SonicTimingService
+		void recordExternal(double waitUs) {
+			if(!external_[0]){
+				const std::string& label = this->moduleDescription().moduleLabel();
+				const auto bounds = SonicHistogram::exponential(10., 2., 21);
+				const char* components[] = {"wait", "queue", "compute"};
+				for(unsigned i = 0; i < 3; ++i){
+					external_[i] = &SonicMetrics::instance().histogram("sonic_external_microseconds",
+						"external work per module: wall time between acquire and produce, and the server queue and compute time in it",
+						{{"module", label}, {"component", components[i]}}, bounds);
+				}
+			}
+			external_[0]->observe(waitUs);
+			const auto& server = client_.serverTime();
+			if(server.valid){
+				external_[1]->observe(server.queueUs);
+				external_[2]->observe(server.computeUs);
+			}
+		}
         virtual void writeData(std::stringstream* msg) {}
         unsigned int sumLoadTime;
         unsigned int numLoadTime;
+        std::chrono::time_point<std::chrono::high_resolution_clock> tPredict_;
+		SonicHistogram* external_[3] = {};
+		SonicMemoryGauge memInput_, memOutput_, memProducer_;
+		SonicBufferPlacement placement_;
 };
 
 #endif
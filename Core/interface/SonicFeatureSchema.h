@@ -0,0 +1,101 @@
+#ifndef SonicCMS_Core_SonicFeatureSchema
+#define SonicCMS_Core_SonicFeatureSchema
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//compile-time description of the rows of a flat (batch x features) input tensor
+//fields are declared as tag types, and their order in the schema defines the layout:
+//	struct Charge : SonicFeature<8> {};
+//	struct Depth : SonicOneHot<7,1> {};
+//	typedef SonicFeatureSchema<Charge,Depth> Schema;
+//offsets and widths are then constants, so the fill/encode loops below have fixed trip counts
+
+//numeric field, possibly with several entries (e.g. one per time sample)
+template <unsigned W, typename T=float>
+struct SonicFeature {
+	typedef T value_type;
+	static constexpr unsigned width = W;
+	static constexpr unsigned cardinality = 0;
+	static constexpr int minValue = 0;
+};
+
+//categorical field, one-hot encoded: values [Min,Min+C) map to C slots
+template <unsigned C, int Min=0>
+struct SonicOneHot {
+	typedef int value_type;
+	static constexpr unsigned width = C;
+	static constexpr unsigned cardinality = C;
+	static constexpr int minValue = Min;
+};
+
+//offset of field F within the list of fields (fails to compile if F is not in the list)
+template <typename F, typename... Fields>
+struct SonicFeatureOffset;
+
+template <typename F, typename... Rest>
+struct SonicFeatureOffset<F,F,Rest...> {
+	static constexpr unsigned value = 0;
+};
+
+template <typename F, typename First, typename... Rest>
+struct SonicFeatureOffset<F,First,Rest...> {
+	static constexpr unsigned value = First::width + SonicFeatureOffset<F,Rest...>::value;
+};
+
+template <typename... Fields>
+class SonicFeatureSchema {
+	public:
+		//number of entries per row
+		static constexpr unsigned size = (0u + ... + Fields::width);
+		static constexpr unsigned nfields = sizeof...(Fields);
+
+		template <typename F>
+		static constexpr unsigned offset() { return SonicFeatureOffset<F,Fields...>::value; }
+
+		//tensor shape for a given batch size
+		static std::vector<int64_t> shape(unsigned batchSize) { return {int64_t(batchSize), int64_t(size)}; }
+
+		//start of row ib in a flat buffer
+		template <typename T, typename A>
+		static T* row(std::vector<T,A>& data, unsigned ib) { return data.data() + ib*size; }
+
+		//scalar field
+		template <typename F, typename T>
+		static void set(float* row, T value) {
+			static_assert(F::width==1 and F::cardinality==0, "set() without index requires a scalar field");
+			row[offset<F>()] = static_cast<float>(value);
+		}
+		//entry i of a vector field
+		template <typename F, typename T>
+		static void set(float* row, unsigned i, T value) {
+			static_assert(F::cardinality==0, "set() requires a numeric field");
+			row[offset<F>()+i] = static_cast<float>(value);
+		}
+		//all entries of a vector field
+		template <typename F, typename T>
+		static void copy(float* row, const T* values) {
+			static_assert(F::cardinality==0, "copy() requires a numeric field");
+			float* out = row + offset<F>();
+			for(unsigned i = 0; i < F::width; ++i) out[i] = static_cast<float>(values[i]);
+		}
+		//one-hot field: all slots are written, out-of-range values leave every slot at zero
+		template <typename F>
+		static void encode(float* row, int value) {
+			static_assert(F::cardinality>0, "encode() requires a one-hot field");
+			float* out = row + offset<F>();
+			const int index = value - F::minValue;
+			for(unsigned i = 0; i < F::cardinality; ++i) out[i] = (int(i)==index) ? 1.f : 0.f;
+		}
+
+		//compare against the row width expected by the client/model
+		static void check(unsigned ninput, const std::string& name) {
+			if(ninput!=size)
+				throw cms::Exception("BadSchema") << name << ": feature schema has " << size << " entries per row, but client expects " << ninput;
+		}
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SonicCMS_Core_SonicInflight
+#define SonicCMS_Core_SonicInflight
+
+#include "SonicCMS/Core/interface/SonicTracer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//live view of the outstanding SONIC requests, for diagnosing stalled jobs without stopping them
+//each client registers one entry (on its first request) and updates it in place with relaxed atomic stores,
+//so there is no locking or allocation per request; a dump may therefore mix fields of consecutive requests
+//dumps are triggered by SonicInflightService (signal or Unix socket query)
+class SonicInflight {
+	public:
+		//queued: predict() called, but the request is not yet being built (e.g. waiting for the pseudo-async thread)
+		//encode: building the request, remote: sent and waiting for the server, decode: handling the response
+		enum Stage { Idle, Queued, Encode, Remote, Decode, NStages };
+		static const char* stageName(Stage stage);
+
+		struct Entry {
+			Entry(const std::string& module_, const std::string& endpoint_) : module(module_), endpoint(endpoint_) {}
+			const std::string module;
+			const std::string endpoint;
+			std::atomic<unsigned> stream{0};
+			std::atomic<uint64_t> event{0};
+			std::atomic<uint64_t> request{0};
+			//steady clock, in ns since its epoch
+			std::atomic<int64_t> start{0};
+			std::atomic<int> stage{Idle};
+
+			void begin(const SonicTraceContext& context) {
+				stream.store(context.stream, std::memory_order_relaxed);
+				event.store(context.event, std::memory_order_relaxed);
+				request.store(context.request, std::memory_order_relaxed);
+				start.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+				stage.store(Queued, std::memory_order_relaxed);
+			}
+			void set(Stage s) { stage.store(s, std::memory_order_relaxed); }
+			void end() { stage.store(Idle, std::memory_order_relaxed); }
+		};
+
+		static SonicInflight& instance();
+
+		//entries are owned by the registry, and removed when the client is destroyed
+		Entry* add(const std::string& module, const std::string& endpoint);
+		void remove(const Entry* entry);
+
+		//outstanding requests (oldest first), followed by the current values of all gauges in the SonicMetrics registry
+		//(in-flight requests and queue depths) and the memory report
+		void dump(std::ostream& os) const;
+
+	private:
+		SonicInflight() {}
+
+		mutable std::mutex mutex_;
+		std::vector<std::unique_ptr<Entry>> entries_;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef SonicCMS_Core_SonicLog
+#define SonicCMS_Core_SonicLog
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//low-overhead diagnostics for hot paths (including client callback threads):
+//	SONIC_LOG("TRTClient", "Remote time: {} us", us);
+//the caller only copies the arguments into a per-thread ring buffer (no locks, no formatting, no allocation);
+//a background thread formats the records and sends them to the MessageLogger (using the category) or to a file
+//arguments are numbers or C strings that outlive the job (e.g. string literals or client debug names)
+//logging is off unless SonicLogService is configured; it can keep 1 in N records of each message and select categories
+//records are dropped (and counted) when a ring buffer is full, rather than blocking the caller
+
+//one per call site (static)
+struct SonicLogFormat {
+	SonicLogFormat(const char* category_, const char* format_) : category(category_), format(format_) {}
+	const char* category;
+	const char* format;
+	//-1 = not yet checked against the configured categories
+	std::atomic<int> selected{-1};
+	std::atomic<uint64_t> count{0};
+};
+
+class SonicLog {
+	public:
+		static constexpr unsigned kMaxArgs = 6;
+		enum class ArgType : uint8_t { Int, UInt, Double, String };
+		struct Arg {
+			ArgType type;
+			union {
+				int64_t i;
+				uint64_t u;
+				double d;
+				const char* s;
+			};
+		};
+		struct Record {
+			const SonicLogFormat* format;
+			int64_t time;
+			uint64_t thread;
+			uint8_t nargs;
+			Arg args[kMaxArgs];
+		};
+
+		struct Config {
+			//file name (empty = MessageLogger)
+			std::string fileName;
+			//keep 1 of every sampleEvery records of each message
+			unsigned sampleEvery = 1;
+			//empty = all
+			std::vector<std::string> categories;
+			std::chrono::milliseconds flushInterval{200};
+		};
+
+		static SonicLog& instance();
+
+		//background thread
+		void start(const Config& config);
+		void stop();
+
+		//called for each record before its arguments are evaluated
+		bool accept(SonicLogFormat& format) {
+			if(!enabled_.load(std::memory_order_relaxed)) return false;
+			int selected = format.selected.load(std::memory_order_relaxed);
+			if(selected < 0){
+				selected = select(format.category);
+				format.selected.store(selected, std::memory_order_relaxed);
+			}
+			return selected and format.count.fetch_add(1, std::memory_order_relaxed) % sampleEvery_.load(std::memory_order_relaxed) == 0;
+		}
+
+		template <typename... Args>
+		void log(const SonicLogFormat& format, Args... args) {
+			static_assert(sizeof...(Args) <= kMaxArgs, "too many arguments for SONIC_LOG");
+			Ring& r = ring();
+			const uint64_t head = r.head.load(std::memory_order_relaxed);
+			if(head - r.tail.load(std::memory_order_acquire) >= Ring::kSize){
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			Record& rec = r.records[head & Ring::kMask];
+			rec.format = &format;
+			rec.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch_).count();
+			rec.thread = r.thread;
+			rec.nargs = sizeof...(Args);
+			unsigned i = 0;
+			((rec.args[i++] = toArg(args)), ...);
+			(void)i;
+			r.head.store(head + 1, std::memory_order_release);
+		}
+
+		uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+	private:
+		//single producer (owning thread), single consumer (background thread)
+		struct Ring {
+			static constexpr uint64_t kSize = 1024;
+			static constexpr uint64_t kMask = kSize - 1;
+			std::atomic<uint64_t> head{0};
+			std::atomic<uint64_t> tail{0};
+			uint64_t thread = 0;
+			//the owning thread has exited (guarded by mutex_)
+			bool released = false;
+			Record records[kSize];
+		};
+		//hands the ring back when its thread exits, so threads that come and go (e.g. client library callbacks) do not leak rings
+		struct RingOwner {
+			Ring* ring = nullptr;
+			~RingOwner();
+		};
+
+		template <typename T>
+		static Arg toArg(T value) {
+			Arg arg;
+			if constexpr(std::is_floating_point<T>::value){ arg.type = ArgType::Double; arg.d = value; }
+			else if constexpr(std::is_integral<T>::value and std::is_signed<T>::value){ arg.type = ArgType::Int; arg.i = value; }
+			else if constexpr(std::is_integral<T>::value){ arg.type = ArgType::UInt; arg.u = value; }
+			else {
+				static_assert(std::is_convertible<T,const char*>::value, "SONIC_LOG arguments must be numbers or C strings");
+				arg.type = ArgType::String;
+				arg.s = value;
+			}
+			return arg;
+		}
+
+		SonicLog() : enabled_(false), stop_(false), sampleEvery_(1), dropped_(0), epoch_(std::chrono::steady_clock::now()) {}
+		Ring& ring();
+		void release(Ring* ring);
+		int select(const char* category) const;
+		void run();
+		void drain();
+		std::string format(const Record& rec) const;
+
+		Config config_;
+		std::atomic<bool> enabled_;
+		bool stop_;
+		//read by every thread that logs, while start() may set it
+		std::atomic<unsigned> sampleEvery_;
+		std::atomic<uint64_t> dropped_;
+		std::chrono::steady_clock::time_point epoch_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::thread thread_;
+		std::vector<std::unique_ptr<Ring>> rings_;
+		std::ofstream file_;
+};
+
+#define SONIC_LOG(category, format, ...) \
+	do { \
+		static SonicLogFormat sonicLogFormat_(category, format); \
+		if(SonicLog::instance().accept(sonicLogFormat_)) SonicLog::instance().log(sonicLogFormat_, ##__VA_ARGS__); \
+	} while(0)
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SonicCMS_Core_SonicMemory
+#define SonicCMS_Core_SonicMemory
+
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//memory held by SONIC clients and producers, per module (debug name), stream, and buffer category:
+//	input, output: client buffers (SonicClientTypes), transport: copies made by the transport layer,
+//	status: server status kept by the client, producer: temporaries kept by the producer between events
+//each category is a pair of gauges in the SonicMetrics registry (current and peak bytes), so it is exported with the other metrics;
+//report() prints a table, at the end of the job (SonicMemoryService) or on demand (SonicInflightService)
+class SonicMemoryGauge {
+	public:
+		void bind(const std::string& module, unsigned stream, const std::string& category);
+		bool bound() const { return current_ != nullptr; }
+		void set(uint64_t bytes) {
+			current_->set(bytes);
+			peak_->max(bytes);
+		}
+
+	private:
+		SonicGauge* current_ = nullptr;
+		SonicGauge* peak_ = nullptr;
+};
+
+namespace sonic_memory {
+	//allocated (not just used) bytes of common buffer types
+	template <typename T>
+	uint64_t bytes(const T&) { return 0; }
+	template <typename T, typename A>
+	uint64_t bytes(const std::vector<T,A>& v) { return v.capacity()*sizeof(T); }
+	//sharded clients: the buffers are owned by the shard clients (which report them), so only the pointers count here
+	template <typename T>
+	uint64_t bytes(const std::vector<T*>& v) { return v.capacity()*sizeof(T*); }
+
+	void report(std::ostream& os);
+}
+
+#endif
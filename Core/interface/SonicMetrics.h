@@ -0,0 +1,184 @@
+#ifndef SonicCMS_Core_SonicMetrics
+#define SonicCMS_Core_SonicMetrics
+
+#include "SonicCMS/Core/interface/SonicAlloc.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//process-wide registry of counters, gauges, and histograms, identified by name and labels (e.g. module and endpoint)
+//metrics are created once (under a lock) and afterwards only updated with relaxed atomic operations,
+//so hot paths should keep the returned references
+//exported by SonicMetricsService (Prometheus text format) and SonicMetricsHarvester (DQM)
+
+class SonicCounter {
+	public:
+		void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+		uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<uint64_t> value_{0};
+};
+
+class SonicGauge {
+	public:
+		void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+		void inc(int64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+		void dec(int64_t n = 1) { value_.fetch_sub(n, std::memory_order_relaxed); }
+		//keep the largest value
+		void max(int64_t v) {
+			int64_t current = value_.load(std::memory_order_relaxed);
+			while(v > current and !value_.compare_exchange_weak(current, v, std::memory_order_relaxed)) {}
+		}
+		int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<int64_t> value_{0};
+};
+
+//bucket i counts values <= bounds[i] (and > bounds[i-1]); the last bucket counts values above all bounds
+class SonicHistogram {
+	public:
+		SonicHistogram(const std::vector<double>& bounds);
+
+		void observe(double value);
+
+		//accessors
+		const std::vector<double>& bounds() const { return bounds_; }
+		unsigned nbuckets() const { return bounds_.size()+1; }
+		uint64_t bucket(unsigned i) const { return buckets_[i].load(std::memory_order_relaxed); }
+		uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+		double sum() const { return sum_.load(std::memory_order_relaxed); }
+
+		//bounds start, start*factor, ..., start*factor^(n-1)
+		static std::vector<double> exponential(double start, double factor, unsigned n);
+
+	private:
+		std::vector<double> bounds_;
+		std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+		std::atomic<uint64_t> count_{0};
+		std::atomic<double> sum_{0.};
+};
+
+class SonicMetrics {
+	public:
+		typedef std::vector<std::pair<std::string,std::string>> Labels;
+		enum class Type { Counter, Gauge, Histogram };
+
+		//one set of label values
+		struct Series {
+			Labels labels;
+			std::unique_ptr<SonicCounter> counter;
+			std::unique_ptr<SonicGauge> gauge;
+			std::unique_ptr<SonicHistogram> histogram;
+		};
+		//all series with the same name
+		struct Family {
+			std::string name;
+			std::string help;
+			Type type;
+			std::map<std::string,Series> series;
+		};
+
+		static SonicMetrics& instance();
+
+		//get or create (help and bounds are taken from the first call)
+		SonicCounter& counter(const std::string& name, const std::string& help, const Labels& labels);
+		SonicGauge& gauge(const std::string& name, const std::string& help, const Labels& labels);
+		SonicHistogram& histogram(const std::string& name, const std::string& help, const Labels& labels, const std::vector<double>& bounds);
+
+		//exporters
+		void writePrometheus(std::ostream& os) const;
+		void forEach(const std::function<void(const Family&)>& func) const;
+
+		//label="value" pairs, comma-separated, with Prometheus escaping
+		static std::string labelString(const Labels& labels);
+
+	private:
+		SonicMetrics() {}
+		Series& series(const std::string& name, const std::string& help, Type type, const Labels& labels);
+
+		mutable std::mutex mutex_;
+		std::map<std::string,Family> families_;
+};
+
+//metrics for one client: created when the client is bound to a module and endpoint
+class SonicClientMetrics {
+	public:
+		//callback = time spent on the client library's callback thread (its sum over time is the occupancy of the completion threads)
+		enum Stage { Acquire, Encode, Remote, Decode, Wait, Produce, Callback, Total, NStages };
+		static const char* stageName(Stage stage);
+		//bytes of one request or response:
+		//raw = tensor bytes filled or read by the client, encoded = tensor bytes after conversion by the transport,
+		//wire = encoded bytes plus protocol framing (message fields, gRPC and HTTP/2 frames), as estimated by the transport
+		struct Payload {
+			uint64_t raw = 0;
+			uint64_t encoded = 0;
+			uint64_t wire = 0;
+		};
+		enum Kind { Raw, Encoded, Wire, NKinds };
+		static const char* kindName(Kind kind);
+
+		void bind(const std::string& module, const std::string& endpoint);
+		bool bound() const { return requests_ != nullptr; }
+
+		//request lifetime (predict to finish)
+		void start() {
+			requests_->inc();
+			inflight_->inc();
+		}
+		void stop(double us, bool failed) {
+			inflight_->dec();
+			if(failed) errors_->inc();
+			stages_[Total]->observe(us);
+		}
+		//durations in microseconds
+		void observe(Stage stage, double us) { stages_[stage]->observe(us); }
+		void sent(const Payload& payload) { count(bytesSent_, sizeSent_, payload); }
+		void received(const Payload& payload) { count(bytesReceived_, sizeReceived_, payload); }
+		//allocations on the calling thread during one stage (only recorded if the allocation hooks are active)
+		void allocated(Stage stage, const SonicAllocStats& stats) {
+			if(!allocCount_[stage]) return;
+			allocCount_[stage]->inc(stats.count);
+			allocBytes_[stage]->inc(stats.bytes);
+		}
+		//time to initialize the client (once per client)
+		void initialized(double us) { init_->observe(us); }
+		//achieved throughput of one round trip (wire bytes in both directions over the remote time)
+		void transferred(uint64_t wireBytes, double us) { if(us > 0) throughput_->observe(wireBytes * 8e-3 / us); }
+
+		//labels of this client, for additional metrics
+		const SonicMetrics::Labels& labels() const { return labels_; }
+
+	private:
+		void count(SonicCounter* const* bytes, SonicHistogram* size, const Payload& payload) {
+			bytes[Raw]->inc(payload.raw);
+			bytes[Encoded]->inc(payload.encoded);
+			bytes[Wire]->inc(payload.wire);
+			size->observe(payload.wire);
+		}
+
+		SonicMetrics::Labels labels_;
+		SonicCounter* requests_ = nullptr;
+		SonicCounter* errors_ = nullptr;
+		SonicCounter* bytesSent_[NKinds] = {};
+		SonicCounter* bytesReceived_[NKinds] = {};
+		SonicHistogram* sizeSent_ = nullptr;
+		SonicHistogram* sizeReceived_ = nullptr;
+		SonicHistogram* throughput_ = nullptr;
+		SonicHistogram* init_ = nullptr;
+		SonicGauge* inflight_ = nullptr;
+		SonicHistogram* stages_[NStages] = {};
+		SonicCounter* allocCount_[NStages] = {};
+		SonicCounter* allocBytes_[NStages] = {};
+};
+
+#endif
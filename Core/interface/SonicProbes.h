@@ -0,0 +1,64 @@
+#ifndef SonicCMS_Core_SonicProbes
+#define SonicCMS_Core_SonicProbes
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//static tracepoints (USDT/SDT) at the SONIC hot-path boundaries, for perf, bpftrace, or systemtap
+//each probe is a single nop in the binary until a tracer attaches, e.g.:
+//	bpftrace -e 'usdt:/path/to/libSonicCMSTensorRT.so:sonic:request__send { @[str(arg0)] = hist(arg3); }'
+//all probes have the same arguments: module (debug name), stream, batch size, bytes (0 if not known at that point)
+//probes: acquire__entry, acquire__exit, predict, request__send, callback, finish, produce__entry, produce__exit
+//if <sys/sdt.h> is not available, or SONIC_DISABLE_PROBES is defined, they compile to nothing
+
+#if !defined(SONIC_DISABLE_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SONIC_HAS_PROBES 1
+#endif
+#endif
+
+#ifdef SONIC_HAS_PROBES
+#define SONIC_PROBE(name, module, stream, batch, bytes) \
+	DTRACE_PROBE4(sonic, name, (const char*)(module), (unsigned)(stream), (unsigned)(batch), (uint64_t)(bytes))
+#else
+#define SONIC_PROBE(name, module, stream, batch, bytes) do {} while(0)
+#endif
+
+//helpers to fill the probe arguments for generic client types
+namespace sonic_probes {
+	//payload size of common input/output types
+	template <typename T>
+	uint64_t bytes(const T&) { return 0; }
+	template <typename T, typename A>
+	uint64_t bytes(const std::vector<T,A>& v) { return v.size()*sizeof(T); }
+	//sharded clients: one buffer per shard
+	template <typename T>
+	uint64_t bytes(const std::vector<T*>& v) {
+		uint64_t result = 0;
+		for(const auto* p : v) result += bytes(*p);
+		return result;
+	}
+	template <typename T>
+	uint64_t bytes(const std::vector<const T*>& v) {
+		uint64_t result = 0;
+		for(const auto* p : v) result += bytes(*p);
+		return result;
+	}
+
+	//batch size, for clients that have one
+	template <typename C, typename = void>
+	struct HasBatchSize : std::false_type {};
+	template <typename C>
+	struct HasBatchSize<C, decltype(void(std::declval<const C&>().batchSize()))> : std::true_type {};
+
+	template <typename C>
+	unsigned batchSize(const C& client) {
+		if constexpr(HasBatchSize<C>::value) return client.batchSize();
+		else return 0;
+	}
+}
+
+#endif
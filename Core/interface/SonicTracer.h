@@ -0,0 +1,87 @@
+#ifndef SonicCMS_Core_SonicTracer
+#define SonicCMS_Core_SonicTracer
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//identifies the event and request that a span belongs to
+struct SonicTraceContext {
+	unsigned stream = 0;
+	uint64_t event = 0;
+	uint64_t request = 0;
+};
+
+//optional timeline of SONIC activity, written in Chrome trace-event JSON (viewable in chrome://tracing or Perfetto)
+//disabled by default (recording is then a single relaxed load); enabled by SonicTraceService
+//spans are kept in per-thread buffers and written at the end of the job
+//tracks: work done on a thread (acquire, encode, callback, decode, produce, other modules) goes on that thread's track,
+//while the outstanding request and server-side spans go on a separate track for each stream
+class SonicTracer {
+	public:
+		typedef std::chrono::high_resolution_clock Clock;
+
+		static SonicTracer& instance();
+
+		void enable() { enabled_.store(true, std::memory_order_relaxed); }
+		bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+		//track ids
+		static uint64_t threadTrack();
+		static uint64_t requestTrack(unsigned stream) { return kRequestTrackOffset + stream; }
+
+		//complete span [start, end]; name and category must be string literals or outlive the tracer, module is copied
+		void span(const char* name, const char* category, uint64_t track, Clock::time_point start, Clock::time_point end,
+		          const SonicTraceContext& context, const std::string& module = std::string());
+
+		void write(std::ostream& os) const;
+
+	private:
+		static constexpr uint64_t kRequestTrackOffset = 1000000;
+
+		struct Span {
+			const char* name;
+			const char* category;
+			uint64_t track;
+			int64_t start;
+			int64_t duration;
+			SonicTraceContext context;
+			std::string module;
+		};
+		typedef std::vector<Span> Buffer;
+
+		SonicTracer() : enabled_(false), epoch_(Clock::now()) {}
+		Buffer& buffer();
+
+		std::atomic<bool> enabled_;
+		Clock::time_point epoch_;
+		mutable std::mutex mutex_;
+		std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+//records a span on the current thread's track from construction to destruction
+class SonicTraceScope {
+	public:
+		SonicTraceScope(const char* name, const SonicTraceContext& context, const std::string& module) :
+			name_(name), context_(context), module_(module), active_(SonicTracer::instance().enabled())
+		{
+			if(active_) start_ = SonicTracer::Clock::now();
+		}
+		~SonicTraceScope() {
+			if(active_) SonicTracer::instance().span(name_, "sonic", SonicTracer::threadTrack(), start_, SonicTracer::Clock::now(), context_, module_);
+		}
+
+	private:
+		const char* name_;
+		const SonicTraceContext& context_;
+		const std::string& module_;
+		bool active_;
+		SonicTracer::Clock::time_point start_;
+};
+
+#endif
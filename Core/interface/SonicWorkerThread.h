@@ -0,0 +1,56 @@
+#ifndef SonicCMS_Core_SonicWorkerThread
+#define SonicCMS_Core_SonicWorkerThread
+
+#include "SonicCMS/Core/interface/SonicAffinity.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//runs one job at a time on a dedicated std::thread (for clients that wait for blocking calls outside of the framework's threads)
+//the job runs with the lock held, so everything written before submit() is visible to it, and the next submit() waits for it to return
+class SonicWorkerThread {
+	public:
+		SonicWorkerThread() : stop_(false), thread_([this](){ run(); }) {}
+		~SonicWorkerThread() {
+			{
+				std::lock_guard<std::mutex> guard(mutex_);
+				stop_ = true;
+			}
+			cond_.notify_one();
+			thread_.join();
+		}
+
+		//prepare (optional) runs on the calling thread with the lock held, i.e. after the previous job has returned
+		void submit(std::function<void()> job, const std::function<void()>& prepare = nullptr) {
+			{
+				std::lock_guard<std::mutex> guard(mutex_);
+				if(prepare) prepare();
+				job_ = std::move(job);
+			}
+			cond_.notify_one();
+		}
+
+	private:
+		void run() {
+			while(true){
+				std::unique_lock<std::mutex> lk(mutex_);
+				cond_.wait(lk, [this](){ return (job_ or stop_); });
+				if(stop_) break;
+				SonicAffinity::instance().pinHelperThread();
+				auto job(std::move(job_));
+				job_ = nullptr;
+				job();
+			}
+		}
+
+		//members (the thread is started last)
+		std::mutex mutex_;
+		std::condition_variable cond_;
+		std::function<void()> job_;
+		bool stop_;
+		std::thread thread_;
+};
+
+#endif
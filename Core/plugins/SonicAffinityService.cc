@@ -0,0 +1,58 @@
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "SonicCMS/Core/interface/SonicAffinity.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//configures SonicAffinity (see SonicAffinity.h) and, with "report", prints the local and cross-node buffer traffic per module at the end of the job
+class SonicAffinityService {
+	public:
+		SonicAffinityService(const edm::ParameterSet& pset, edm::ActivityRegistry& registry) {
+			SonicAffinity::Config config;
+			for(auto cpu : pset.getUntrackedParameter<std::vector<unsigned>>("helperCpus", {})) config.helperCpus.push_back(cpu);
+			for(auto node : pset.getUntrackedParameter<std::vector<int>>("bufferNodes", {})) config.bufferNodes.push_back(node);
+			config.report = pset.getUntrackedParameter<bool>("report", false);
+			SonicAffinity::instance().configure(config);
+			if(config.report) registry.watchPostEndJob(this, &SonicAffinityService::postEndJob);
+		}
+
+	private:
+		void postEndJob() {
+			//module -> (local, remote)
+			std::map<std::string,std::pair<uint64_t,uint64_t>> bytes;
+			SonicMetrics::instance().forEach([&bytes](const SonicMetrics::Family& family){
+				const bool local = family.name == "sonic_numa_local_bytes_total";
+				if(!local and family.name != "sonic_numa_remote_bytes_total") return;
+				for(const auto& s : family.series){
+					for(const auto& label : s.second.labels){
+						if(label.first != "module") continue;
+						auto& entry = bytes[label.second];
+						(local ? entry.first : entry.second) += s.second.counter->value();
+					}
+				}
+			});
+			if(bytes.empty()) return;
+
+			std::ostringstream out;
+			out << "SONIC buffer traffic by NUMA locality (MB)\n";
+			out << std::left << std::setw(32) << "module" << std::right << std::setw(12) << "local" << std::setw(12) << "remote" << std::setw(10) << "remote%" << "\n";
+			out << std::fixed << std::setprecision(1);
+			for(const auto& entry : bytes){
+				const uint64_t total = entry.second.first + entry.second.second;
+				out << std::left << std::setw(32) << entry.first << std::right
+					<< std::setw(12) << entry.second.first/1e6 << std::setw(12) << entry.second.second/1e6
+					<< std::setw(10) << (total ? 100.*entry.second.second/total : 0.) << "\n";
+			}
+			edm::LogVerbatim("SonicAffinityService") << out.str();
+		}
+};
+
+DEFINE_FWK_SERVICE(SonicAffinityService);
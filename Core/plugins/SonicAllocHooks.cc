@@ -0,0 +1,43 @@
+#include "SonicCMS/Core/interface/SonicAlloc.h"
+
+#include <cstdlib>
+#include <new>
+
+//replacements for the global allocation functions, built as a separate library that is only used with LD_PRELOAD (see SonicAlloc.h)
+//malloc/free underneath, as in the default implementations,
+//so memory allocated before the hooks took effect can still be released here (and vice versa)
+
+namespace {
+	//constant-initialized, so the first access from inside operator new does not allocate
+	thread_local SonicAllocStats threadStats;
+
+	inline void* allocate(std::size_t size) {
+		++threadStats.count;
+		threadStats.bytes += size;
+		return std::malloc(size ? size : 1);
+	}
+}
+
+//found by sonic_alloc::current()
+extern "C" SonicAllocStats sonic_alloc_current() {
+	return threadStats;
+}
+
+void* operator new(std::size_t size) {
+	void* ptr = allocate(size);
+	if(!ptr) throw std::bad_alloc();
+	return ptr;
+}
+void* operator new[](std::size_t size) {
+	void* ptr = allocate(size);
+	if(!ptr) throw std::bad_alloc();
+	return ptr;
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
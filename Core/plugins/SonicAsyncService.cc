@@ -0,0 +1,16 @@
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "SonicCMS/Core/interface/SonicAsyncEngine.h"
+
+//sets the number of threads of the shared completion engines (see SonicAsyncEngine.h); services are created before the modules
+class SonicAsyncService {
+	public:
+		SonicAsyncService(const edm::ParameterSet& pset, edm::ActivityRegistry&) {
+			sonic_async::setThreads(pset.getUntrackedParameter<unsigned>("threads", 2));
+			edm::LogInfo("SonicAsyncService") << "Shared completion engines use " << sonic_async::threads() << " threads";
+		}
+};
+
+DEFINE_FWK_SERVICE(SonicAsyncService);
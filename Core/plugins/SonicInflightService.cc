@@ -0,0 +1,150 @@
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "SonicCMS/Core/interface/SonicAffinity.h"
+#include "SonicCMS/Core/interface/SonicInflight.h"
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//dumps the outstanding SONIC requests (see SonicInflight) while the job is running:
+//	kill -USR1 <pid>                           (written to dumpFile, or to stderr)
+//	socat - UNIX-CONNECT:<socketPath>          (written to the connection)
+//the signal handler only writes to a pipe; the dump is done by a helper thread, which never blocks the event loop
+class SonicInflightService {
+	public:
+		SonicInflightService(const edm::ParameterSet& pset, edm::ActivityRegistry& registry) :
+			signal_(pset.getUntrackedParameter<bool>("signal", true)),
+			socketPath_(pset.getUntrackedParameter<std::string>("socketPath", "")),
+			dumpFile_(pset.getUntrackedParameter<std::string>("dumpFile", "")),
+			socket_(-1)
+		{
+			if(::pipe2(pipe_, O_CLOEXEC | O_NONBLOCK) != 0)
+				throw cms::Exception("Configuration") << "SonicInflightService: unable to create pipe: " << std::strerror(errno);
+			if(!socketPath_.empty()) openSocket();
+			if(signal_){
+				wakeFd() = pipe_[1];
+				struct sigaction action;
+				std::memset(&action, 0, sizeof(action));
+				action.sa_handler = &SonicInflightService::handleSignal;
+				action.sa_flags = SA_RESTART;
+				sigemptyset(&action.sa_mask);
+				::sigaction(SIGUSR1, &action, &previous_);
+			}
+			thread_ = std::thread(&SonicInflightService::run, this);
+			registry.watchPostEndJob(this, &SonicInflightService::postEndJob);
+		}
+		~SonicInflightService() { postEndJob(); }
+
+	private:
+		static std::atomic<int>& wakeFd() {
+			static std::atomic<int> fd{-1};
+			return fd;
+		}
+		//async-signal-safe: one byte to the pipe
+		static void handleSignal(int) {
+			const int fd = wakeFd().load();
+			if(fd >= 0){
+				const char c = 'd';
+				[[maybe_unused]] auto n = ::write(fd, &c, 1);
+			}
+		}
+
+		void openSocket() {
+			socket_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			sockaddr_un addr;
+			std::memset(&addr, 0, sizeof(addr));
+			addr.sun_family = AF_UNIX;
+			if(socket_ < 0 or socketPath_.size() >= sizeof(addr.sun_path))
+				throw cms::Exception("Configuration") << "SonicInflightService: unable to create socket " << socketPath_;
+			std::strncpy(addr.sun_path, socketPath_.c_str(), sizeof(addr.sun_path)-1);
+			::unlink(socketPath_.c_str());
+			if(::bind(socket_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 or ::listen(socket_, 4) != 0)
+				throw cms::Exception("Configuration") << "SonicInflightService: unable to listen on " << socketPath_ << ": " << std::strerror(errno);
+		}
+
+		void run() {
+			SonicAffinity::instance().pinHelperThread();
+			pollfd fds[2] = {{pipe_[0], POLLIN, 0}, {socket_, POLLIN, 0}};
+			const nfds_t nfds = socket_ >= 0 ? 2 : 1;
+			while(true){
+				if(::poll(fds, nfds, -1) < 0){
+					if(errno == EINTR) continue;
+					break;
+				}
+				if(fds[0].revents & POLLIN){
+					char buf[64];
+					bool stop = false;
+					ssize_t n;
+					while((n = ::read(pipe_[0], buf, sizeof(buf))) > 0){
+						for(ssize_t i = 0; i < n; ++i) stop |= buf[i]=='q';
+					}
+					if(stop) break;
+					dumpToFile();
+				}
+				if(nfds > 1 and (fds[1].revents & POLLIN)){
+					const int conn = ::accept4(socket_, nullptr, nullptr, SOCK_CLOEXEC);
+					if(conn < 0) continue;
+					std::ostringstream os;
+					SonicInflight::instance().dump(os);
+					const std::string text(os.str());
+					for(size_t done = 0; done < text.size();){
+						const ssize_t n = ::write(conn, text.data() + done, text.size() - done);
+						if(n <= 0) break;
+						done += n;
+					}
+					::close(conn);
+				}
+			}
+		}
+
+		void dumpToFile() {
+			if(dumpFile_.empty()) SonicInflight::instance().dump(std::cerr);
+			else {
+				std::ofstream out(dumpFile_, std::ios::app);
+				SonicInflight::instance().dump(out);
+			}
+		}
+
+		void postEndJob() {
+			if(!thread_.joinable()) return;
+			if(signal_){
+				::sigaction(SIGUSR1, &previous_, nullptr);
+				wakeFd() = -1;
+			}
+			const char c = 'q';
+			[[maybe_unused]] auto n = ::write(pipe_[1], &c, 1);
+			thread_.join();
+			if(socket_ >= 0){
+				::close(socket_);
+				::unlink(socketPath_.c_str());
+				socket_ = -1;
+			}
+			::close(pipe_[0]);
+			::close(pipe_[1]);
+		}
+
+		bool signal_;
+		std::string socketPath_;
+		std::string dumpFile_;
+		int pipe_[2];
+		int socket_;
+		struct sigaction previous_;
+		std::thread thread_;
+};
+
+DEFINE_FWK_SERVICE(SonicInflightService);
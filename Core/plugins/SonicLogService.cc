@@ -0,0 +1,26 @@
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "SonicCMS/Core/interface/SonicLog.h"
+
+#include <string>
+#include <vector>
+
+//enables SONIC_LOG records and flushes them from a background thread until the end of the job
+class SonicLogService {
+	public:
+		SonicLogService(const edm::ParameterSet& pset, edm::ActivityRegistry& registry) {
+			SonicLog::Config config;
+			config.fileName = pset.getUntrackedParameter<std::string>("fileName", "");
+			config.sampleEvery = pset.getUntrackedParameter<unsigned>("sampleEvery", 1);
+			config.categories = pset.getUntrackedParameter<std::vector<std::string>>("categories", std::vector<std::string>());
+			config.flushInterval = std::chrono::milliseconds(pset.getUntrackedParameter<unsigned>("flushInterval", 200));
+			SonicLog::instance().start(config);
+			registry.watchPostEndJob(this, &SonicLogService::postEndJob);
+		}
+
+	private:
+		void postEndJob() { SonicLog::instance().stop(); }
+};
+
+DEFINE_FWK_SERVICE(SonicLogService);
@@ -0,0 +1,24 @@
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "SonicCMS/Core/interface/SonicMemory.h"
+
+#include <sstream>
+
+//prints the memory held by SONIC clients and producers (see SonicMemory.h) at the end of the job
+class SonicMemoryService {
+	public:
+		SonicMemoryService(const edm::ParameterSet&, edm::ActivityRegistry& registry) {
+			registry.watchPostEndJob(this, &SonicMemoryService::postEndJob);
+		}
+
+	private:
+		void postEndJob() {
+			std::ostringstream out;
+			sonic_memory::report(out);
+			if(!out.str().empty()) edm::LogVerbatim("SonicMemoryService") << out.str();
+		}
+};
+
+DEFINE_FWK_SERVICE(SonicMemoryService);
@@ -0,0 +1,58 @@
+#include "DQMServices/Core/interface/DQMEDHarvester.h"
+#include "DQMServices/Core/interface/MonitorElement.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <cctype>
+#include <string>
+#include <vector>
+
+//copies the SONIC metrics registry into DQM MonitorElements at the end of the job,
+//so they are saved next to the FastTimerService DQM output:
+//each histogram series becomes a 1D histogram, and each counter or gauge family becomes a 1D histogram with one labeled bin per series
+class SonicMetricsHarvester : public DQMEDHarvester {
+	public:
+		explicit SonicMetricsHarvester(const edm::ParameterSet& cfg) : folder_(cfg.getParameter<std::string>("folder")) {}
+
+		void dqmEndJob(DQMStore::IBooker& ibooker, DQMStore::IGetter& igetter) override {
+			ibooker.setCurrentFolder(folder_);
+			SonicMetrics::instance().forEach([&ibooker](const SonicMetrics::Family& family){
+				if(family.type == SonicMetrics::Type::Histogram){
+					for(const auto& s : family.series){
+						const auto& h = *s.second.histogram;
+						//bucket i is [bounds[i-1], bounds[i]], starting from 0; the last bucket is the overflow
+						std::vector<float> edges(1, 0.f);
+						for(double b : h.bounds()) edges.push_back(b);
+						MonitorElement* me = ibooker.book1D(name(family.name, s.second.labels), family.help, edges.size()-1, edges.data());
+						for(unsigned i = 0; i < h.nbuckets(); ++i) me->setBinContent(i+1, h.bucket(i));
+						me->setEntries(h.count());
+					}
+				}
+				else if(!family.series.empty()){
+					MonitorElement* me = ibooker.book1D(family.name, family.help, family.series.size(), 0, family.series.size());
+					unsigned bin = 1;
+					for(const auto& s : family.series){
+						me->setBinContent(bin, s.second.counter ? double(s.second.counter->value()) : double(s.second.gauge->value()));
+						me->setBinLabel(bin, s.first);
+						++bin;
+					}
+				}
+			});
+		}
+
+	private:
+		//MonitorElement names cannot contain the label syntax
+		static std::string name(const std::string& base, const SonicMetrics::Labels& labels) {
+			std::string result(base);
+			for(const auto& label : labels){
+				result += "_";
+				for(char c : label.second) result += (std::isalnum(c) ? c : '_');
+			}
+			return result;
+		}
+
+		std::string folder_;
+};
+
+DEFINE_FWK_MODULE(SonicMetricsHarvester);
@@ -0,0 +1,104 @@
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "FWCore/ServiceRegistry/interface/StreamContext.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "SonicCMS/Core/interface/SonicAlloc.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+//writes the SONIC metrics registry to a Prometheus textfile (e.g. for the node exporter textfile collector)
+//every "interval" seconds (checked after each event) and at the end of the job
+//if the allocation hooks are active (see SonicAlloc.h), the allocations per request for each stage are also reported at the end of the job,
+//and the job fails if any exceeds "allocationBudget" (if not negative), so allocation-free hot paths can be enforced in benchmarks
+class SonicMetricsService {
+	public:
+		SonicMetricsService(const edm::ParameterSet& pset, edm::ActivityRegistry& registry) :
+			fileName_(pset.getUntrackedParameter<std::string>("fileName", "sonic_metrics.prom")),
+			interval_(std::chrono::seconds(pset.getUntrackedParameter<unsigned>("interval", 30))),
+			next_(std::chrono::steady_clock::now() + interval_),
+			allocationBudget_(pset.getUntrackedParameter<int>("allocationBudget", -1))
+		{
+			registry.watchPostEvent(this, &SonicMetricsService::postEvent);
+			registry.watchPostEndJob(this, &SonicMetricsService::postEndJob);
+		}
+
+	private:
+		void postEvent(edm::StreamContext const&) {
+			auto now = std::chrono::steady_clock::now();
+			if(now < next_.load()) return;
+			//only one stream writes; the others continue
+			std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+			if(!lock.owns_lock()) return;
+			next_ = now + interval_;
+			write();
+		}
+		void postEndJob() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			write();
+			if(sonic_alloc::enabled()) reportAllocations();
+		}
+
+		void reportAllocations() const {
+			//same labels (module, endpoint, stage) for the allocation counters and the latency histograms,
+			//so the number of latency observations is the number of times each stage ran
+			struct Allocations {
+				uint64_t count = 0;
+				uint64_t bytes = 0;
+				uint64_t calls = 0;
+				bool tracked = false;
+			};
+			std::map<std::string,Allocations> allocations;
+			SonicMetrics::instance().forEach([&allocations](const SonicMetrics::Family& family){
+				for(const auto& s : family.series){
+					if(family.name == "sonic_allocations_total"){
+						allocations[s.first].count = s.second.counter->value();
+						allocations[s.first].tracked = true;
+					}
+					else if(family.name == "sonic_allocated_bytes_total") allocations[s.first].bytes = s.second.counter->value();
+					else if(family.name == "sonic_latency_microseconds") allocations[s.first].calls = s.second.histogram->count();
+				}
+			});
+
+			std::stringstream msg, over;
+			msg << "Allocations per request:";
+			for(const auto& a : allocations){
+				const auto& entry = a.second;
+				if(!entry.tracked or entry.calls == 0) continue;
+				const double count = double(entry.count)/entry.calls;
+				msg << "\n  {" << a.first << "}: " << count << " (" << double(entry.bytes)/entry.calls << " bytes)";
+				if(allocationBudget_ >= 0 and count > allocationBudget_) over << "\n  {" << a.first << "}: " << count;
+			}
+			edm::LogInfo("SonicMetricsService") << msg.str();
+			if(!over.str().empty())
+				throw cms::Exception("AllocationBudget") << "allocations per request exceed the budget of " << allocationBudget_ << ":" << over.str();
+		}
+
+		//write and rename, so collectors never see a partial file
+		void write() {
+			const std::string tmp(fileName_ + ".tmp");
+			{
+				std::ofstream out(tmp);
+				SonicMetrics::instance().writePrometheus(out);
+			}
+			if(std::rename(tmp.c_str(), fileName_.c_str()) != 0)
+				edm::LogWarning("SonicMetricsService") << "unable to write " << fileName_;
+		}
+
+		std::string fileName_;
+		std::chrono::steady_clock::duration interval_;
+		std::atomic<std::chrono::steady_clock::time_point> next_;
+		int allocationBudget_;
+		std::mutex mutex_;
+};
+
+DEFINE_FWK_SERVICE(SonicMetricsService);
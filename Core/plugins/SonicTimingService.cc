@@ -0,0 +1,132 @@
+#include "DataFormats/Provenance/interface/ModuleDescription.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/PathsAndConsumesOfModulesBase.h"
+#include "FWCore/ServiceRegistry/interface/ProcessContext.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//companion to the FastTimerService job summary: the FastTimerService only sees the acquire() and produce() calls of SONIC modules,
+//so this service reports the external work in between (recorded by SonicEDProducer for each module label),
+//split into server queue, server compute, and the remainder (network, client, and scheduling), per module and per path
+//(modules that only run unscheduled are listed per module, but not on a path)
+class SonicTimingService {
+	public:
+		SonicTimingService(const edm::ParameterSet&, edm::ActivityRegistry& registry) {
+			registry.watchPreBeginJob(this, &SonicTimingService::preBeginJob);
+			registry.watchPostEndJob(this, &SonicTimingService::postEndJob);
+		}
+
+	private:
+		struct External {
+			uint64_t events = 0;
+			double wait = 0;
+			//only from requests where the server reported its time
+			uint64_t serverEvents = 0;
+			double queue = 0;
+			double compute = 0;
+		};
+
+		void preBeginJob(edm::PathsAndConsumesOfModulesBase const& pathsAndConsumes, edm::ProcessContext const&) {
+			const auto& paths = pathsAndConsumes.paths();
+			for(unsigned i = 0; i < paths.size(); ++i){
+				auto& labels = paths_[paths[i]];
+				for(const auto* module : pathsAndConsumes.modulesOnPath(i)) labels.push_back(module->moduleLabel());
+			}
+			const auto& endPaths = pathsAndConsumes.endPaths();
+			for(unsigned i = 0; i < endPaths.size(); ++i){
+				auto& labels = paths_[endPaths[i]];
+				for(const auto* module : pathsAndConsumes.modulesOnEndPath(i)) labels.push_back(module->moduleLabel());
+			}
+		}
+
+		void postEndJob() {
+			std::map<std::string,External> modules;
+			SonicMetrics::instance().forEach([&modules](const SonicMetrics::Family& family){
+				if(family.name != "sonic_external_microseconds") return;
+				for(const auto& s : family.series){
+					std::string module, component;
+					for(const auto& label : s.second.labels){
+						if(label.first=="module") module = label.second;
+						else if(label.first=="component") component = label.second;
+					}
+					const auto& h = *s.second.histogram;
+					auto& ext = modules[module];
+					if(component=="wait"){ ext.events = h.count(); ext.wait = h.sum(); }
+					else if(component=="queue"){ ext.serverEvents = h.count(); ext.queue = h.sum(); }
+					else if(component=="compute") ext.compute = h.sum();
+				}
+			});
+			if(modules.empty()) return;
+
+			std::ostringstream out;
+			out << "SONIC external work (ms per event; server times averaged over the events where the server reported them)\n";
+			header(out, "module");
+			std::map<std::string,Row> rows;
+			for(const auto& m : modules){
+				rows[m.first] = perEvent(m.second);
+				print(out, m.first, rows[m.first]);
+			}
+			out << "\n";
+			header(out, "path");
+			for(const auto& p : paths_){
+				//modules on a path run in sequence for each event
+				Row total;
+				bool any = false;
+				for(const auto& label : p.second){
+					auto it = rows.find(label);
+					if(it == rows.end()) continue;
+					any = true;
+					total.events = std::max(total.events, it->second.events);
+					total.serverEvents = std::max(total.serverEvents, it->second.serverEvents);
+					total.wait += it->second.wait;
+					total.queue += it->second.queue;
+					total.compute += it->second.compute;
+				}
+				if(any) print(out, p.first, total);
+			}
+			edm::LogVerbatim("SonicTimingService") << out.str();
+		}
+
+		//ms per event
+		struct Row {
+			uint64_t events = 0;
+			uint64_t serverEvents = 0;
+			double wait = 0;
+			double queue = 0;
+			double compute = 0;
+		};
+		static Row perEvent(const External& ext) {
+			Row row;
+			row.events = ext.events;
+			row.serverEvents = ext.serverEvents;
+			if(ext.events > 0) row.wait = ext.wait / ext.events * 1e-3;
+			if(ext.serverEvents > 0){
+				row.queue = ext.queue / ext.serverEvents * 1e-3;
+				row.compute = ext.compute / ext.serverEvents * 1e-3;
+			}
+			return row;
+		}
+
+		static void header(std::ostringstream& out, const std::string& name) {
+			out << std::left << std::setw(40) << name << std::right << std::setw(10) << "events" << std::setw(12) << "external"
+				<< std::setw(12) << "queue" << std::setw(12) << "compute" << std::setw(12) << "other" << std::setw(14) << "server stats" << "\n";
+		}
+		static void print(std::ostringstream& out, const std::string& name, const Row& row) {
+			out << std::left << std::setw(40) << name << std::right << std::setw(10) << row.events << std::fixed << std::setprecision(3)
+				<< std::setw(12) << row.wait << std::setw(12) << row.queue << std::setw(12) << row.compute
+				<< std::setw(12) << std::max(row.wait - row.queue - row.compute, 0.) << std::setw(14) << row.serverEvents << "\n";
+		}
+
+		std::map<std::string,std::vector<std::string>> paths_;
+};
+
+DEFINE_FWK_SERVICE(SonicTimingService);
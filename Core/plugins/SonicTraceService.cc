@@ -0,0 +1,65 @@
+#include "DataFormats/Provenance/interface/ModuleDescription.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ModuleCallingContext.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "FWCore/ServiceRegistry/interface/StreamContext.h"
+#include "SonicCMS/Core/interface/SonicTracer.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+//enables the SonicTracer and writes the timeline to a Chrome trace-event JSON file at the end of the job
+//all modules are also recorded (optionally), so the outstanding requests can be compared with the rest of the work on each stream
+class SonicTraceService {
+	public:
+		SonicTraceService(const edm::ParameterSet& pset, edm::ActivityRegistry& registry) :
+			fileName_(pset.getUntrackedParameter<std::string>("fileName", "sonic_trace.json")),
+			traceModules_(pset.getUntrackedParameter<bool>("traceModules", true))
+		{
+			SonicTracer::instance().enable();
+			if(traceModules_){
+				registry.watchPreModuleEvent(this, &SonicTraceService::preModule);
+				registry.watchPostModuleEvent(this, &SonicTraceService::postModule);
+				registry.watchPreModuleEventAcquire(this, &SonicTraceService::preModule);
+				registry.watchPostModuleEventAcquire(this, &SonicTraceService::postModuleAcquire);
+			}
+			registry.watchPostEndJob(this, &SonicTraceService::postEndJob);
+		}
+
+	private:
+		//a module runs on one thread from pre to post, and modules run on demand nest inside others
+		static std::vector<SonicTracer::Clock::time_point>& starts() {
+			static thread_local std::vector<SonicTracer::Clock::time_point> stack;
+			return stack;
+		}
+		void preModule(edm::StreamContext const&, edm::ModuleCallingContext const&) {
+			starts().push_back(SonicTracer::Clock::now());
+		}
+		void record(edm::StreamContext const& sc, edm::ModuleCallingContext const& mcc, const char* category) {
+			auto& stack = starts();
+			if(stack.empty()) return;
+			const auto start = stack.back();
+			stack.pop_back();
+			SonicTraceContext context;
+			context.stream = sc.streamID().value();
+			context.event = sc.eventID().event();
+			//module labels are owned by the module descriptions, which outlive the end of the job
+			SonicTracer::instance().span(mcc.moduleDescription()->moduleLabel().c_str(), category, SonicTracer::threadTrack(), start, SonicTracer::Clock::now(), context);
+		}
+		void postModule(edm::StreamContext const& sc, edm::ModuleCallingContext const& mcc) { record(sc, mcc, "module"); }
+		void postModuleAcquire(edm::StreamContext const& sc, edm::ModuleCallingContext const& mcc) { record(sc, mcc, "module acquire"); }
+
+		void postEndJob() {
+			std::ofstream out(fileName_);
+			SonicTracer::instance().write(out);
+			edm::LogInfo("SonicTraceService") << "Wrote trace to " << fileName_;
+		}
+
+		std::string fileName_;
+		bool traceModules_;
+};
+
+DEFINE_FWK_SERVICE(SonicTraceService);
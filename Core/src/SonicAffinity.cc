@@ -0,0 +1,97 @@
+#include "SonicCMS/Core/interface/SonicAffinity.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+	//from <numaif.h>
+	constexpr int kMpolPreferred = 1;
+	constexpr unsigned long kMaxNodes = 64;
+
+	uintptr_t pageSize() {
+		static const uintptr_t size = ::sysconf(_SC_PAGESIZE);
+		return size;
+	}
+	size_t mappedBytes(size_t bytes) {
+		return (std::max<size_t>(bytes, 1) + pageSize() - 1) & ~(pageSize() - 1);
+	}
+}
+
+SonicAffinity& SonicAffinity::instance() {
+	static SonicAffinity affinity;
+	return affinity;
+}
+
+void SonicAffinity::configure(const Config& config) {
+	config_ = config;
+	enabled_ = true;
+}
+
+void SonicAffinity::pinHelperThread() {
+	static thread_local bool pinned = false;
+	if(pinned or !enabled() or config_.helperCpus.empty()) return;
+	pinned = true;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for(unsigned cpu : config_.helperCpus) CPU_SET(cpu, &set);
+	::sched_setaffinity(0, sizeof(set), &set);
+}
+
+int SonicAffinity::bufferNode(unsigned stream) const {
+	if(!enabled() or config_.bufferNodes.empty()) return -1;
+	return config_.bufferNodes[stream % config_.bufferNodes.size()];
+}
+
+int SonicAffinity::currentNode() {
+	unsigned cpu = 0, node = 0;
+	if(::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return -1;
+	return node;
+}
+
+int SonicAffinity::nodeOf(const void* ptr) {
+	if(!ptr) return -1;
+	//query only (no target nodes)
+	void* page = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(ptr) & ~(pageSize()-1));
+	int status = -1;
+	if(::syscall(SYS_move_pages, 0, 1, &page, nullptr, &status, 0) != 0) return -1;
+	return status;
+}
+
+void* SonicAffinity::allocate(size_t bytes, int node) {
+	const size_t length = mappedBytes(bytes);
+	void* ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(ptr == MAP_FAILED) throw std::bad_alloc();
+	//preferred rather than strict, so a full node falls back to the others instead of failing
+	if(node >= 0 and node < int(kMaxNodes)){
+		unsigned long mask = 1ul << node;
+		::syscall(SYS_mbind, ptr, length, kMpolPreferred, &mask, kMaxNodes, 0);
+	}
+	return ptr;
+}
+
+void SonicAffinity::deallocate(void* ptr, size_t bytes) {
+	if(ptr) ::munmap(ptr, mappedBytes(bytes));
+}
+
+void SonicBufferPlacement::bind(const std::string& module) {
+	auto& registry = SonicMetrics::instance();
+	const char* directions[] = {"write", "read"};
+	for(unsigned i = 0; i < 2; ++i){
+		local_[i] = &registry.counter("sonic_numa_local_bytes_total", "buffer bytes accessed from a thread on the same NUMA node", {{"module", module}, {"access", directions[i]}});
+		remote_[i] = &registry.counter("sonic_numa_remote_bytes_total", "buffer bytes accessed from a thread on another NUMA node", {{"module", module}, {"access", directions[i]}});
+	}
+}
+
+void SonicBufferPlacement::access(Direction direction, const void* data, size_t bytes) {
+	if(!data or bytes == 0) return;
+	//the buffer is assumed to be on the node of its first page
+	const int thread = SonicAffinity::currentNode();
+	const int buffer = SonicAffinity::nodeOf(data);
+	if(thread < 0 or buffer < 0) return;
+	(thread == buffer ? local_ : remote_)[direction]->inc(bytes);
+}
@@ -0,0 +1,21 @@
+#include "SonicCMS/Core/interface/SonicAlloc.h"
+
+#include <dlfcn.h>
+
+namespace {
+	//provided by libSonicCMSCoreAllocHooks, if it was preloaded
+	typedef SonicAllocStats (*CurrentFunction)();
+	CurrentFunction hooks() {
+		static const CurrentFunction function = reinterpret_cast<CurrentFunction>(::dlsym(RTLD_DEFAULT, "sonic_alloc_current"));
+		return function;
+	}
+}
+
+bool sonic_alloc::enabled() {
+	return hooks() != nullptr;
+}
+
+SonicAllocStats sonic_alloc::current() {
+	const auto function = hooks();
+	return function ? function() : SonicAllocStats();
+}
@@ -0,0 +1,13 @@
+#include "SonicCMS/Core/interface/SonicAsyncEngine.h"
+
+namespace {
+	std::atomic<unsigned> nthreads{2};
+}
+
+unsigned sonic_async::threads() {
+	return nthreads.load(std::memory_order_relaxed);
+}
+
+void sonic_async::setThreads(unsigned n) {
+	nthreads.store(n > 0 ? n : 1, std::memory_order_relaxed);
+}
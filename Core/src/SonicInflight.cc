@@ -0,0 +1,75 @@
+#include "SonicCMS/Core/interface/SonicInflight.h"
+#include "SonicCMS/Core/interface/SonicMemory.h"
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <unistd.h>
+
+const char* SonicInflight::stageName(Stage stage) {
+	static const char* names[] = {"idle", "queued", "encode", "remote", "decode"};
+	return stage < NStages ? names[stage] : "unknown";
+}
+
+SonicInflight& SonicInflight::instance() {
+	static SonicInflight inflight;
+	return inflight;
+}
+
+SonicInflight::Entry* SonicInflight::add(const std::string& module, const std::string& endpoint) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.push_back(std::make_unique<Entry>(module, endpoint));
+	return entries_.back().get();
+}
+
+void SonicInflight::remove(const Entry* entry) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [entry](const std::unique_ptr<Entry>& e){ return e.get()==entry; }), entries_.end());
+}
+
+void SonicInflight::dump(std::ostream& os) const {
+	struct Row {
+		const Entry* entry;
+		unsigned stream;
+		uint64_t event, request;
+		int64_t start;
+		int stage;
+	};
+	const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+	std::vector<Row> rows;
+	unsigned nclients = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		nclients = entries_.size();
+		for(const auto& e : entries_){
+			const int stage = e->stage.load(std::memory_order_relaxed);
+			if(stage == Idle) continue;
+			rows.push_back(Row{e.get(), e->stream.load(std::memory_order_relaxed), e->event.load(std::memory_order_relaxed),
+				e->request.load(std::memory_order_relaxed), e->start.load(std::memory_order_relaxed), stage});
+		}
+		std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b){ return a.start < b.start; });
+
+		const std::time_t wall = std::time(nullptr);
+		os << "SONIC in-flight requests (pid " << ::getpid() << ", " << std::put_time(std::localtime(&wall), "%F %T") << "): "
+			<< rows.size() << " outstanding, " << nclients << " clients\n";
+		os << std::left << std::setw(32) << "module" << " " << std::setw(6) << "stream" << " " << std::setw(12) << "event" << " "
+			<< std::setw(8) << "request" << " " << std::setw(8) << "stage" << " " << std::setw(10) << "age(ms)" << " endpoint\n";
+		for(const auto& r : rows){
+			os << std::left << std::setw(32) << r.entry->module << " " << std::setw(6) << r.stream << " " << std::setw(12) << r.event << " "
+				<< std::setw(8) << r.request << " " << std::setw(8) << stageName(static_cast<Stage>(r.stage)) << " "
+				<< std::setw(10) << (now - r.start)/1000000 << " " << r.entry->endpoint << "\n";
+		}
+	}
+
+	os << "gauges:\n";
+	SonicMetrics::instance().forEach([&os](const SonicMetrics::Family& family){
+		//memory is summarized below
+		if(family.type != SonicMetrics::Type::Gauge or family.name.compare(0, 12, "sonic_memory") == 0) return;
+		for(const auto& s : family.series){
+			if(s.second.gauge) os << "  " << family.name << "{" << s.first << "} " << s.second.gauge->value() << "\n";
+		}
+	});
+	sonic_memory::report(os);
+	os.flush();
+}
@@ -0,0 +1,124 @@
+#include "SonicCMS/Core/interface/SonicLog.h"
+#include "SonicCMS/Core/interface/SonicAffinity.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+SonicLog& SonicLog::instance() {
+	static SonicLog log;
+	return log;
+}
+
+SonicLog::RingOwner::~RingOwner() {
+	if(ring) SonicLog::instance().release(ring);
+	ring = nullptr;
+}
+
+SonicLog::Ring& SonicLog::ring() {
+	//registered once per thread, then written without locking
+	static thread_local RingOwner owner;
+	if(!owner.ring){
+		auto r = std::make_unique<Ring>();
+		r->thread = ::syscall(SYS_gettid);
+		std::lock_guard<std::mutex> lock(mutex_);
+		rings_.push_back(std::move(r));
+		owner.ring = rings_.back().get();
+	}
+	return *owner.ring;
+}
+
+//called when the owning thread exits: the ring is freed now if it is empty,
+//otherwise by drain() once its records are written (the background thread is woken up, so rings of short-lived threads do not pile up)
+void SonicLog::release(Ring* ring) {
+	bool pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		ring->released = true;
+		pending = ring->tail.load(std::memory_order_relaxed) != ring->head.load(std::memory_order_relaxed);
+		if(!pending) rings_.erase(std::find_if(rings_.begin(), rings_.end(), [ring](const std::unique_ptr<Ring>& r){ return r.get() == ring; }));
+	}
+	if(pending) cv_.notify_all();
+}
+
+int SonicLog::select(const char* category) const {
+	if(config_.categories.empty()) return 1;
+	return std::find(config_.categories.begin(), config_.categories.end(), category) != config_.categories.end();
+}
+
+void SonicLog::start(const Config& config) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(enabled_) return;
+	config_ = config;
+	sampleEvery_.store(std::max(config.sampleEvery, 1u), std::memory_order_relaxed);
+	if(!config_.fileName.empty()) file_.open(config_.fileName);
+	stop_ = false;
+	thread_ = std::thread(&SonicLog::run, this);
+	enabled_ = true;
+}
+
+void SonicLog::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(!enabled_) return;
+		enabled_ = false;
+		stop_ = true;
+	}
+	cv_.notify_all();
+	thread_.join();
+	//records written after the last pass
+	std::lock_guard<std::mutex> lock(mutex_);
+	drain();
+	if(dropped() > 0) edm::LogWarning("SonicLog") << dropped() << " records were dropped because the buffers were full";
+	if(file_.is_open()) file_.close();
+}
+
+void SonicLog::run() {
+	SonicAffinity::instance().pinHelperThread();
+	std::unique_lock<std::mutex> lock(mutex_);
+	while(!stop_){
+		cv_.wait_for(lock, config_.flushInterval);
+		drain();
+	}
+}
+
+//called with mutex_ held
+void SonicLog::drain() {
+	for(auto& r : rings_){
+		uint64_t tail = r->tail.load(std::memory_order_relaxed);
+		const uint64_t head = r->head.load(std::memory_order_acquire);
+		for(; tail != head; ++tail){
+			const Record& rec = r->records[tail & Ring::kMask];
+			if(file_.is_open()) file_ << rec.time << " " << rec.thread << " " << rec.format->category << " " << format(rec) << "\n";
+			else edm::LogInfo(rec.format->category) << format(rec);
+			r->tail.store(tail + 1, std::memory_order_release);
+		}
+	}
+	//rings of exited threads are now empty
+	rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::unique_ptr<Ring>& r){ return r->released; }), rings_.end());
+	if(file_.is_open()) file_.flush();
+}
+
+//"{}" placeholders are replaced by the arguments in order
+std::string SonicLog::format(const Record& rec) const {
+	std::ostringstream os;
+	const char* fmt = rec.format->format;
+	unsigned iarg = 0;
+	while(*fmt){
+		if(fmt[0]=='{' and fmt[1]=='}' and iarg < rec.nargs){
+			const Arg& arg = rec.args[iarg++];
+			switch(arg.type){
+				case ArgType::Int: os << arg.i; break;
+				case ArgType::UInt: os << arg.u; break;
+				case ArgType::Double: os << arg.d; break;
+				case ArgType::String: os << (arg.s ? arg.s : "(null)"); break;
+			}
+			fmt += 2;
+		}
+		else os << *fmt++;
+	}
+	return os.str();
+}
@@ -0,0 +1,56 @@
+#include "SonicCMS/Core/interface/SonicMemory.h"
+
+#include <iomanip>
+#include <map>
+#include <tuple>
+
+void SonicMemoryGauge::bind(const std::string& module, unsigned stream, const std::string& category) {
+	auto& registry = SonicMetrics::instance();
+	const SonicMetrics::Labels labels{{"module", module}, {"stream", std::to_string(stream)}, {"category", category}};
+	current_ = &registry.gauge("sonic_memory_bytes", "bytes held by SONIC clients and producers", labels);
+	peak_ = &registry.gauge("sonic_memory_peak_bytes", "peak bytes held by SONIC clients and producers", labels);
+}
+
+void sonic_memory::report(std::ostream& os) {
+	//module, stream, category -> current, peak
+	typedef std::tuple<std::string,unsigned,std::string> Key;
+	std::map<Key,std::pair<int64_t,int64_t>> entries;
+	SonicMetrics::instance().forEach([&entries](const SonicMetrics::Family& family){
+		const bool current = family.name == "sonic_memory_bytes";
+		if(!current and family.name != "sonic_memory_peak_bytes") return;
+		for(const auto& s : family.series){
+			Key key;
+			for(const auto& label : s.second.labels){
+				if(label.first=="module") std::get<0>(key) = label.second;
+				else if(label.first=="stream") std::get<1>(key) = std::stoul(label.second);
+				else if(label.first=="category") std::get<2>(key) = label.second;
+			}
+			auto& entry = entries[key];
+			(current ? entry.first : entry.second) = s.second.gauge->value();
+		}
+	});
+	if(entries.empty()) return;
+
+	//totals per module and category (over streams), and overall
+	std::map<std::pair<std::string,std::string>,std::pair<int64_t,int64_t>> totals;
+	int64_t totalCurrent = 0, totalPeak = 0;
+	os << "SONIC memory (bytes)\n";
+	os << std::left << std::setw(32) << "module" << std::right << std::setw(8) << "stream" << "  " << std::left << std::setw(10) << "category"
+		<< std::right << std::setw(14) << "current" << std::setw(14) << "peak" << "\n";
+	for(const auto& e : entries){
+		os << std::left << std::setw(32) << std::get<0>(e.first) << std::right << std::setw(8) << std::get<1>(e.first) << "  "
+			<< std::left << std::setw(10) << std::get<2>(e.first) << std::right << std::setw(14) << e.second.first << std::setw(14) << e.second.second << "\n";
+		auto& total = totals[std::make_pair(std::get<0>(e.first), std::get<2>(e.first))];
+		total.first += e.second.first;
+		total.second += e.second.second;
+		totalCurrent += e.second.first;
+		totalPeak += e.second.second;
+	}
+	os << "totals over streams (the sum of peaks is an upper bound, since the streams do not peak together)\n";
+	for(const auto& t : totals){
+		os << std::left << std::setw(32) << t.first.first << std::right << std::setw(8) << "all" << "  " << std::left << std::setw(10) << t.first.second
+			<< std::right << std::setw(14) << t.second.first << std::setw(14) << t.second.second << "\n";
+	}
+	os << std::left << std::setw(32) << "all" << std::right << std::setw(8) << "all" << "  " << std::left << std::setw(10) << "all"
+		<< std::right << std::setw(14) << totalCurrent << std::setw(14) << totalPeak << "\n";
+}
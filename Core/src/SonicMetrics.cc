@@ -0,0 +1,158 @@
+#include "SonicCMS/Core/interface/SonicMetrics.h"
+
+#include <algorithm>
+
+SonicHistogram::SonicHistogram(const std::vector<double>& bounds) :
+	bounds_(bounds), buckets_(new std::atomic<uint64_t>[bounds.size()+1])
+{
+	std::sort(bounds_.begin(), bounds_.end());
+	for(unsigned i = 0; i < nbuckets(); ++i) buckets_[i].store(0, std::memory_order_relaxed);
+}
+
+void SonicHistogram::observe(double value) {
+	const unsigned i = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+	buckets_[i].fetch_add(1, std::memory_order_relaxed);
+	count_.fetch_add(1, std::memory_order_relaxed);
+	double sum = sum_.load(std::memory_order_relaxed);
+	while(!sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {}
+}
+
+std::vector<double> SonicHistogram::exponential(double start, double factor, unsigned n) {
+	std::vector<double> bounds;
+	bounds.reserve(n);
+	for(double b = start; bounds.size() < n; b *= factor) bounds.push_back(b);
+	return bounds;
+}
+
+SonicMetrics& SonicMetrics::instance() {
+	static SonicMetrics metrics;
+	return metrics;
+}
+
+SonicMetrics::Series& SonicMetrics::series(const std::string& name, const std::string& help, Type type, const Labels& labels) {
+	auto& family = families_[name];
+	if(family.name.empty()){
+		family.name = name;
+		family.help = help;
+		family.type = type;
+	}
+	auto& series = family.series[labelString(labels)];
+	if(series.labels.empty()) series.labels = labels;
+	return series;
+}
+
+SonicCounter& SonicMetrics::counter(const std::string& name, const std::string& help, const Labels& labels) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto& s = series(name, help, Type::Counter, labels);
+	if(!s.counter) s.counter = std::make_unique<SonicCounter>();
+	return *s.counter;
+}
+
+SonicGauge& SonicMetrics::gauge(const std::string& name, const std::string& help, const Labels& labels) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto& s = series(name, help, Type::Gauge, labels);
+	if(!s.gauge) s.gauge = std::make_unique<SonicGauge>();
+	return *s.gauge;
+}
+
+SonicHistogram& SonicMetrics::histogram(const std::string& name, const std::string& help, const Labels& labels, const std::vector<double>& bounds) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto& s = series(name, help, Type::Histogram, labels);
+	if(!s.histogram) s.histogram = std::make_unique<SonicHistogram>(bounds);
+	return *s.histogram;
+}
+
+std::string SonicMetrics::labelString(const Labels& labels) {
+	std::string result;
+	for(const auto& label : labels){
+		if(!result.empty()) result += ",";
+		result += label.first + "=\"";
+		for(char c : label.second){
+			if(c=='\\' or c=='"') result += '\\';
+			if(c=='\n') result += "\\n";
+			else result += c;
+		}
+		result += "\"";
+	}
+	return result;
+}
+
+void SonicMetrics::forEach(const std::function<void(const Family&)>& func) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	for(const auto& family : families_) func(family.second);
+}
+
+void SonicMetrics::writePrometheus(std::ostream& os) const {
+	static const char* typeNames[] = {"counter", "gauge", "histogram"};
+	forEach([&os](const Family& family){
+		os << "# HELP " << family.name << " " << family.help << "\n";
+		os << "# TYPE " << family.name << " " << typeNames[static_cast<int>(family.type)] << "\n";
+		for(const auto& s : family.series){
+			const std::string& labels = s.first;
+			if(s.second.counter) os << family.name << "{" << labels << "} " << s.second.counter->value() << "\n";
+			else if(s.second.gauge) os << family.name << "{" << labels << "} " << s.second.gauge->value() << "\n";
+			else if(s.second.histogram){
+				const auto& h = *s.second.histogram;
+				const std::string sep(labels.empty() ? "" : ",");
+				//buckets are cumulative in the exposition format
+				uint64_t cumulative = 0;
+				for(unsigned i = 0; i < h.nbuckets(); ++i){
+					cumulative += h.bucket(i);
+					os << family.name << "_bucket{" << labels << sep << "le=\"";
+					if(i < h.bounds().size()) os << h.bounds()[i];
+					else os << "+Inf";
+					os << "\"} " << cumulative << "\n";
+				}
+				os << family.name << "_sum{" << labels << "} " << h.sum() << "\n";
+				os << family.name << "_count{" << labels << "} " << h.count() << "\n";
+			}
+		}
+	});
+}
+
+const char* SonicClientMetrics::stageName(Stage stage) {
+	static const char* names[] = {"acquire", "encode", "remote", "decode", "wait", "produce", "callback", "total"};
+	return names[stage];
+}
+
+const char* SonicClientMetrics::kindName(Kind kind) {
+	static const char* names[] = {"raw", "encoded", "wire"};
+	return names[kind];
+}
+
+void SonicClientMetrics::bind(const std::string& module, const std::string& endpoint) {
+	auto& registry = SonicMetrics::instance();
+	labels_ = {{"module", module}, {"endpoint", endpoint}};
+	requests_ = &registry.counter("sonic_requests_total", "requests sent by the client", labels_);
+	errors_ = &registry.counter("sonic_errors_total", "requests that finished with an exception", labels_);
+	auto sentLabels(labels_), receivedLabels(labels_);
+	sentLabels.emplace_back("direction", "sent");
+	receivedLabels.emplace_back("direction", "received");
+	for(unsigned i = 0; i < NKinds; ++i){
+		auto sentKind(sentLabels), receivedKind(receivedLabels);
+		sentKind.emplace_back("kind", kindName(static_cast<Kind>(i)));
+		receivedKind.emplace_back("kind", kindName(static_cast<Kind>(i)));
+		bytesSent_[i] = &registry.counter("sonic_bytes_total", "payload bytes (raw tensors, encoded tensors, or estimated on the wire)", sentKind);
+		bytesReceived_[i] = &registry.counter("sonic_bytes_total", "payload bytes (raw tensors, encoded tensors, or estimated on the wire)", receivedKind);
+	}
+	//64 B to ~1 GB
+	const auto sizeBounds = SonicHistogram::exponential(64., 4., 13);
+	sizeSent_ = &registry.histogram("sonic_message_bytes", "estimated wire bytes per request or response", sentLabels, sizeBounds);
+	sizeReceived_ = &registry.histogram("sonic_message_bytes", "estimated wire bytes per request or response", receivedLabels, sizeBounds);
+	//1 Mbit/s to ~65 Gbit/s
+	throughput_ = &registry.histogram("sonic_throughput_gbps", "achieved throughput per request (wire bytes in both directions over the remote time), in Gbit/s", labels_, SonicHistogram::exponential(0.001, 2., 17));
+	//1 ms to ~65 s
+	init_ = &registry.histogram("sonic_init_microseconds", "time to initialize each client (connections, model metadata), per stream", labels_, SonicHistogram::exponential(1000., 2., 17));
+	inflight_ = &registry.gauge("sonic_inflight_requests", "requests sent and not yet finished", labels_);
+	//10 us to ~10 s
+	const auto bounds = SonicHistogram::exponential(10., 2., 21);
+	for(unsigned i = 0; i < NStages; ++i){
+		auto stageLabels(labels_);
+		stageLabels.emplace_back("stage", stageName(static_cast<Stage>(i)));
+		stages_[i] = &registry.histogram("sonic_latency_microseconds", "duration of each processing stage", stageLabels, bounds);
+		if(sonic_alloc::enabled()){
+			allocCount_[i] = &registry.counter("sonic_allocations_total", "heap allocations during each processing stage", stageLabels);
+			allocBytes_[i] = &registry.counter("sonic_allocated_bytes_total", "heap bytes allocated during each processing stage", stageLabels);
+		}
+	}
+}
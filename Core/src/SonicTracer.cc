@@ -0,0 +1,66 @@
+#include "SonicCMS/Core/interface/SonicTracer.h"
+
+#include <set>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+SonicTracer& SonicTracer::instance() {
+	static SonicTracer tracer;
+	return tracer;
+}
+
+uint64_t SonicTracer::threadTrack() {
+	static thread_local uint64_t tid = ::syscall(SYS_gettid);
+	return tid;
+}
+
+SonicTracer::Buffer& SonicTracer::buffer() {
+	//registered once per thread, then appended to without locking
+	static thread_local Buffer* local = nullptr;
+	if(!local){
+		std::lock_guard<std::mutex> lock(mutex_);
+		buffers_.push_back(std::make_unique<Buffer>());
+		local = buffers_.back().get();
+		local->reserve(4096);
+	}
+	return *local;
+}
+
+void SonicTracer::span(const char* name, const char* category, uint64_t track, Clock::time_point start, Clock::time_point end,
+                       const SonicTraceContext& context, const std::string& module) {
+	if(!enabled()) return;
+	using std::chrono::duration_cast;
+	using std::chrono::microseconds;
+	buffer().push_back(Span{name, category, track,
+		duration_cast<microseconds>(start - epoch_).count(), duration_cast<microseconds>(end - start).count(), context, module});
+}
+
+void SonicTracer::write(std::ostream& os) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	const auto pid = ::getpid();
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	std::set<uint64_t> tracks;
+	for(const auto& buffer : buffers_){
+		for(const auto& s : *buffer){
+			if(!first) os << ",\n";
+			first = false;
+			tracks.insert(s.track);
+			os << "{\"name\":\"" << s.name << "\",\"cat\":\"" << s.category << "\",\"ph\":\"X\""
+				<< ",\"ts\":" << s.start << ",\"dur\":" << s.duration << ",\"pid\":" << pid << ",\"tid\":" << s.track
+				<< ",\"args\":{\"stream\":" << s.context.stream << ",\"event\":" << s.context.event << ",\"request\":" << s.context.request;
+			if(!s.module.empty()) os << ",\"module\":\"" << s.module << "\"";
+			os << "}}";
+		}
+	}
+	//readable track names
+	for(auto track : tracks){
+		if(!first) os << ",\n";
+		first = false;
+		os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << track << ",\"args\":{\"name\":\"";
+		if(track >= kRequestTrackOffset) os << "stream " << track - kRequestTrackOffset << " requests";
+		else os << "thread " << track;
+		os << "\"}}";
+	}
+	os << "\n]}\n";
+}
@@ -0,0 +1,557 @@
+//node-local proxy for the TensorRT inference server gRPC protocol
+//cmsRun processes on the same node connect over a Unix socket (client transport "unix" or "shm"),
+//requests for the same model are coalesced into larger batches and sent over a few persistent upstream connections,
+//and outputs for clients using shared memory are written directly into their registered regions
+//
+//usage: sonicProxy --upstream host:port [--listen unix:/tmp/sonic.sock] [--connections 4]
+//                  [--max-batch 16000] [--max-delay-us 500] [--timeout 300]
+//                  [--metrics file.prom] [--metrics-interval 10]
+//kill -USR1 <pid> prints the queued requests and batches to stderr
+
+#include "grpc_service.grpc.pb.h"
+#include "grpc_service.pb.h"
+#include "api.pb.h"
+#include "request_status.pb.h"
+
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ni = nvidia::inferenceserver;
+typedef std::chrono::steady_clock Clock;
+
+namespace {
+	std::atomic<bool> stopRequested{false};
+	void handleSignal(int) { stopRequested = true; }
+	std::atomic<bool> dumpRequested{false};
+	void handleDump(int) { dumpRequested = true; }
+
+	void setStatus(ni::RequestStatus* status, ni::RequestStatusCode code, const std::string& msg) {
+		status->set_code(code);
+		status->set_msg(msg);
+		status->set_server_id("sonic-proxy");
+	}
+}
+
+//node-level counters, written in Prometheus text format
+struct ProxyMetrics {
+	std::atomic<uint64_t> requests{0};
+	std::atomic<uint64_t> batches{0};
+	std::atomic<uint64_t> rows{0};
+	std::atomic<uint64_t> errors{0};
+	std::atomic<uint64_t> bytesIn{0};
+	std::atomic<uint64_t> bytesOut{0};
+	std::atomic<uint64_t> queueUs{0};
+	std::atomic<uint64_t> upstreamUs{0};
+	std::atomic<uint64_t> shmRegions{0};
+
+	void write(const std::string& path) const {
+		//write and rename, so collectors never see a partial file
+		const std::string tmp(path + ".tmp");
+		{
+			std::ofstream out(tmp);
+			auto counter = [&out](const char* name, const char* help, double value){
+				out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n" << name << " " << value << "\n";
+			};
+			counter("sonic_proxy_requests_total", "client requests received", requests);
+			counter("sonic_proxy_batches_total", "upstream requests sent", batches);
+			counter("sonic_proxy_rows_total", "batch entries sent upstream", rows);
+			counter("sonic_proxy_errors_total", "client requests that failed", errors);
+			counter("sonic_proxy_input_bytes_total", "input tensor bytes sent upstream", bytesIn);
+			counter("sonic_proxy_output_bytes_total", "output tensor bytes returned to clients", bytesOut);
+			counter("sonic_proxy_queue_seconds_total", "time client requests waited to be batched", queueUs*1e-6);
+			counter("sonic_proxy_upstream_seconds_total", "time spent in upstream requests", upstreamUs*1e-6);
+			out << "# HELP sonic_proxy_shm_regions registered client shared memory regions\n# TYPE sonic_proxy_shm_regions gauge\n"
+				<< "sonic_proxy_shm_regions " << shmRegions << "\n";
+		}
+		std::rename(tmp.c_str(), path.c_str());
+	}
+};
+
+//client shared memory regions, mapped in this process
+class ShmRegistry {
+	public:
+		struct Region {
+			uint8_t* base = nullptr;
+			size_t size = 0;
+		};
+
+		~ShmRegistry() { unregisterAll(); }
+
+		bool add(const std::string& name, const std::string& key, size_t offset, size_t size, std::string& msg) {
+			int fd = ::shm_open(key.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+			if(fd < 0) { msg = "unable to open shared memory " + key + ": " + std::strerror(errno); return false; }
+			void* addr = ::mmap(nullptr, offset + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			if(addr == MAP_FAILED) { msg = "unable to map shared memory " + key + ": " + std::strerror(errno); return false; }
+			std::lock_guard<std::mutex> lock(mutex_);
+			remove(name);
+			regions_[name] = Mapping{static_cast<uint8_t*>(addr), offset, size};
+			return true;
+		}
+		void unregister(const std::string& name) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			remove(name);
+		}
+		void unregisterAll() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			for(auto& r : regions_) ::munmap(r.second.addr, r.second.offset + r.second.size);
+			regions_.clear();
+		}
+		//bounds-checked view of [offset, offset+size) within a region
+		bool get(const ni::SharedMemoryRegion& shm, Region& region) const {
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto it = regions_.find(shm.name());
+			if(it == regions_.end() or shm.offset() + shm.byte_size() > it->second.size) return false;
+			region.base = it->second.addr + it->second.offset + shm.offset();
+			region.size = shm.byte_size();
+			return true;
+		}
+		size_t size() const {
+			std::lock_guard<std::mutex> lock(mutex_);
+			return regions_.size();
+		}
+
+	private:
+		struct Mapping {
+			uint8_t* addr;
+			size_t offset;
+			size_t size;
+		};
+		void remove(const std::string& name) {
+			auto it = regions_.find(name);
+			if(it == regions_.end()) return;
+			::munmap(it->second.addr, it->second.offset + it->second.size);
+			regions_.erase(it);
+		}
+
+		mutable std::mutex mutex_;
+		std::map<std::string, Mapping> regions_;
+};
+
+//one client request waiting to be sent
+struct Pending {
+	const ni::InferRequest* request = nullptr;
+	ni::InferResponse* response = nullptr;
+	//input data for the whole client batch (in the request or in client shared memory)
+	std::vector<std::pair<const char*, size_t>> inputs;
+	unsigned batchSize = 0;
+	//requests with the same key can be coalesced
+	std::string key;
+	bool solo = false;
+	Clock::time_point arrival;
+	std::promise<void> done;
+};
+
+class SonicProxy final : public ni::GRPCService::Service {
+	public:
+		SonicProxy(const std::string& upstream, unsigned nconn, unsigned maxBatch, unsigned maxDelayUs, unsigned timeout) :
+			maxBatch_(maxBatch), maxDelay_(std::chrono::microseconds(maxDelayUs)), timeout_(timeout), stop_(false), drained_(false)
+		{
+			for(unsigned i = 0; i < nconn; ++i){
+				//distinct channel arguments force separate connections
+				grpc::ChannelArguments args;
+				args.SetMaxSendMessageSize(-1);
+				args.SetMaxReceiveMessageSize(-1);
+				args.SetInt("sonic.proxy.connection", i);
+				stubs_.push_back(ni::GRPCService::NewStub(grpc::CreateCustomChannel(upstream, grpc::InsecureChannelCredentials(), args)));
+			}
+			batcher_ = std::thread(&SonicProxy::batch, this);
+			for(unsigned i = 0; i < nconn; ++i){
+				workers_.emplace_back(&SonicProxy::work, this, i);
+			}
+		}
+		~SonicProxy() override { stop(); }
+
+		//pending requests are still sent before the threads exit
+		void stop() {
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if(stop_) return;
+				stop_ = true;
+			}
+			cv_.notify_all();
+			batcher_.join();
+			{
+				std::lock_guard<std::mutex> lock(readyMutex_);
+				drained_ = true;
+			}
+			readyCv_.notify_all();
+			for(auto& w : workers_) w.join();
+		}
+
+		const ProxyMetrics& metrics() const { return metrics_; }
+
+		//queued client requests for each batching key (with the age of the oldest), batches waiting for a connection, and batches being sent
+		void dump(std::ostream& os) {
+			const auto now = Clock::now();
+			std::map<std::string, std::pair<unsigned, Clock::time_point>> queued;
+			size_t nqueued = 0, nready = 0;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				nqueued = queue_.size();
+				for(const auto* p : queue_){
+					auto it = queued.emplace(p->key, std::make_pair(0u, p->arrival)).first;
+					++it->second.first;
+					it->second.second = std::min(it->second.second, p->arrival);
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(readyMutex_);
+				nready = ready_.size();
+			}
+			os << "sonicProxy: " << nqueued << " queued requests, " << nready << " batches waiting for a connection, "
+				<< sending_ << " batches being sent (" << stubs_.size() << " connections)\n";
+			for(const auto& q : queued){
+				os << "  " << q.first << ": " << q.second.first << " requests, oldest "
+					<< std::chrono::duration_cast<std::chrono::milliseconds>(now - q.second.second).count() << " ms\n";
+			}
+			os.flush();
+		}
+
+		//model metadata and health are forwarded unchanged
+		grpc::Status Status(grpc::ServerContext*, const ni::StatusRequest* request, ni::StatusResponse* response) override {
+			grpc::ClientContext ctx;
+			return stubs_[0]->Status(&ctx, *request, response);
+		}
+		grpc::Status Health(grpc::ServerContext*, const ni::HealthRequest* request, ni::HealthResponse* response) override {
+			grpc::ClientContext ctx;
+			return stubs_[0]->Health(&ctx, *request, response);
+		}
+
+		//client regions are mapped here; the upstream server never sees them
+		grpc::Status SharedMemoryControl(grpc::ServerContext*, const ni::SharedMemoryControlRequest* request, ni::SharedMemoryControlResponse* response) override {
+			std::string msg;
+			bool ok = true;
+			if(request->has_register_()){
+				const auto& reg = request->register_();
+				ok = shm_.add(reg.name(), reg.system_identifier().shared_memory_key(), reg.system_identifier().offset(), reg.byte_size(), msg);
+			}
+			else if(request->has_unregister()) shm_.unregister(request->unregister().name());
+			else if(request->has_unregister_all()) shm_.unregisterAll();
+			else { ok = false; msg = "unsupported shared memory request"; }
+			metrics_.shmRegions = shm_.size();
+			setStatus(response->mutable_request_status(), ok ? ni::RequestStatusCode::SUCCESS : ni::RequestStatusCode::INVALID_ARG, msg);
+			return grpc::Status::OK;
+		}
+
+		grpc::Status Infer(grpc::ServerContext*, const ni::InferRequest* request, ni::InferResponse* response) override {
+			++metrics_.requests;
+			Pending p;
+			std::string msg;
+			if(!prepare(*request, response, p, msg)){
+				++metrics_.errors;
+				setStatus(response->mutable_request_status(), ni::RequestStatusCode::INVALID_ARG, msg);
+				return grpc::Status::OK;
+			}
+			auto done = p.done.get_future();
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				queue_.push_back(&p);
+			}
+			cv_.notify_all();
+			done.wait();
+			return grpc::Status::OK;
+		}
+
+		grpc::Status StreamInfer(grpc::ServerContext* context, grpc::ServerReaderWriter<ni::InferResponse, ni::InferRequest>* stream) override {
+			ni::InferRequest request;
+			while(stream->Read(&request)){
+				ni::InferResponse response;
+				Infer(context, &request, &response);
+				stream->Write(response);
+			}
+			return grpc::Status::OK;
+		}
+
+	private:
+		//resolve the input data and the batching key for one request
+		bool prepare(const ni::InferRequest& request, ni::InferResponse* response, Pending& p, std::string& msg) {
+			const auto& header = request.meta_data();
+			p.request = &request;
+			p.response = response;
+			p.batchSize = std::max<unsigned>(header.batch_size(), 1);
+			p.arrival = Clock::now();
+			p.key = request.model_name() + ":" + std::to_string(request.model_version());
+			int iraw = 0;
+			for(const auto& input : header.input()){
+				p.key += "|" + input.name();
+				for(auto d : input.dims()) p.key += "," + std::to_string(d);
+				if(input.has_shared_memory()){
+					ShmRegistry::Region region;
+					if(!shm_.get(input.shared_memory(), region)){ msg = "unknown or too small shared memory region for input " + input.name(); return false; }
+					p.inputs.emplace_back(reinterpret_cast<const char*>(region.base), region.size);
+				}
+				else {
+					if(iraw >= request.raw_input_size()){ msg = "missing data for input " + input.name(); return false; }
+					const auto& raw = request.raw_input(iraw++);
+					p.inputs.emplace_back(raw.data(), raw.size());
+				}
+			}
+			for(const auto& output : header.output()){
+				p.key += "|" + output.name();
+				//classification results cannot be split between clients
+				if(output.has_cls()){
+					if(output.has_shared_memory()){ msg = "classification output " + output.name() + " cannot use shared memory"; return false; }
+					p.solo = true;
+				}
+			}
+			if(p.batchSize >= maxBatch_) p.solo = true;
+			return true;
+		}
+
+		unsigned queuedRows(const std::string& key) const {
+			unsigned rows = 0;
+			for(const auto* p : queue_) if(p->key == key and !p->solo) rows += p->batchSize;
+			return rows;
+		}
+
+		//form batches: wait up to maxDelay_ after the oldest request for more requests with the same key
+		void batch() {
+			while(true){
+				std::vector<Pending*> batch;
+				{
+					std::unique_lock<std::mutex> lock(mutex_);
+					cv_.wait(lock, [this]{ return stop_ or !queue_.empty(); });
+					if(stop_ and queue_.empty()) return;
+					Pending* first = queue_.front();
+					const auto deadline = first->arrival + maxDelay_;
+					while(!stop_ and !first->solo and queuedRows(first->key) < maxBatch_ and Clock::now() < deadline){
+						cv_.wait_until(lock, deadline);
+					}
+					unsigned rows = 0;
+					for(auto it = queue_.begin(); it != queue_.end();){
+						Pending* p = *it;
+						const bool take = p == first or (!first->solo and !p->solo and p->key == first->key and rows + p->batchSize <= maxBatch_);
+						if(take){
+							rows += p->batchSize;
+							batch.push_back(p);
+							it = queue_.erase(it);
+						}
+						else ++it;
+					}
+				}
+				{
+					std::lock_guard<std::mutex> lock(readyMutex_);
+					ready_.push_back(std::move(batch));
+				}
+				readyCv_.notify_one();
+			}
+		}
+
+		//send batches over one upstream connection
+		void work(unsigned iconn) {
+			while(true){
+				std::vector<Pending*> batch;
+				{
+					std::unique_lock<std::mutex> lock(readyMutex_);
+					readyCv_.wait(lock, [this]{ return drained_ or !ready_.empty(); });
+					if(ready_.empty()) return;
+					batch = std::move(ready_.front());
+					ready_.pop_front();
+				}
+				++sending_;
+				send(*stubs_[iconn], batch);
+				--sending_;
+				for(auto* p : batch) p->done.set_value();
+			}
+		}
+
+		void fail(const std::vector<Pending*>& batch, ni::RequestStatusCode code, const std::string& msg) {
+			for(auto* p : batch) setStatus(p->response->mutable_request_status(), code, msg);
+			metrics_.errors += batch.size();
+		}
+
+		void send(ni::GRPCService::Stub& stub, const std::vector<Pending*>& batch) {
+			const Pending& first = *batch.front();
+			const auto& header = first.request->meta_data();
+			const auto t0 = Clock::now();
+
+			//concatenate the client batches
+			ni::InferRequest request;
+			request.set_model_name(first.request->model_name());
+			request.set_model_version(first.request->model_version());
+			auto* meta = request.mutable_meta_data();
+			meta->set_id(header.id());
+			unsigned rows = 0;
+			for(auto* p : batch){
+				rows += p->batchSize;
+				metrics_.queueUs += std::chrono::duration_cast<std::chrono::microseconds>(t0 - p->arrival).count();
+			}
+			meta->set_batch_size(rows);
+			for(int i = 0; i < header.input_size(); ++i){
+				auto* input = meta->add_input();
+				input->set_name(header.input(i).name());
+				*input->mutable_dims() = header.input(i).dims();
+				std::string* raw = request.add_raw_input();
+				size_t nbytes = 0;
+				for(auto* p : batch) nbytes += p->inputs[i].second;
+				raw->reserve(nbytes);
+				for(auto* p : batch) raw->append(p->inputs[i].first, p->inputs[i].second);
+				input->set_batch_byte_size(nbytes);
+				metrics_.bytesIn += nbytes;
+			}
+			for(const auto& output : header.output()){
+				auto* out = meta->add_output();
+				out->set_name(output.name());
+				if(output.has_cls()) *out->mutable_cls() = output.cls();
+			}
+
+			grpc::ClientContext ctx;
+			ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(timeout_));
+			ni::InferResponse response;
+			grpc::Status status = stub.Infer(&ctx, request, &response);
+			metrics_.upstreamUs += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count();
+			++metrics_.batches;
+			metrics_.rows += rows;
+
+			if(!status.ok()) return fail(batch, ni::RequestStatusCode::UNAVAILABLE, "upstream: " + status.error_message());
+			if(response.request_status().code() != ni::RequestStatusCode::SUCCESS){
+				for(auto* p : batch) *p->response->mutable_request_status() = response.request_status();
+				metrics_.errors += batch.size();
+				return;
+			}
+			//single request without shared memory outputs: nothing to split
+			bool shmOutput = false;
+			for(const auto& output : header.output()) shmOutput |= output.has_shared_memory();
+			if(first.solo and !shmOutput){
+				response.mutable_meta_data()->set_id(header.id());
+				*first.response = std::move(response);
+				return;
+			}
+
+			//split the outputs by batch entry
+			const auto& rheader = response.meta_data();
+			unsigned row = 0;
+			for(auto* p : batch){
+				const auto& cheader = p->request->meta_data();
+				auto* cmeta = p->response->mutable_meta_data();
+				cmeta->set_id(cheader.id());
+				cmeta->set_model_name(rheader.model_name());
+				cmeta->set_model_version(rheader.model_version());
+				cmeta->set_batch_size(cheader.batch_size());
+				for(int j = 0; j < cheader.output_size(); ++j){
+					const auto& coutput = cheader.output(j);
+					int k = 0;
+					while(k < rheader.output_size() and rheader.output(k).name() != coutput.name()) ++k;
+					if(k == rheader.output_size() or k >= response.raw_output_size()) return fail(batch, ni::RequestStatusCode::INTERNAL, "missing output " + coutput.name());
+					const std::string& raw = response.raw_output(k);
+					const size_t rowBytes = raw.size() / rows;
+					const size_t nbytes = rowBytes * p->batchSize;
+					const char* data = raw.data() + rowBytes * row;
+					auto* out = cmeta->add_output();
+					out->set_name(coutput.name());
+					*out->mutable_raw()->mutable_dims() = rheader.output(k).raw().dims();
+					out->mutable_raw()->set_batch_byte_size(nbytes);
+					if(coutput.has_shared_memory()){
+						ShmRegistry::Region region;
+						if(!shm_.get(coutput.shared_memory(), region) or region.size < nbytes) return fail(batch, ni::RequestStatusCode::INVALID_ARG, "unknown or too small shared memory region for output " + coutput.name());
+						std::memcpy(region.base, data, nbytes);
+					}
+					else p->response->add_raw_output(data, nbytes);
+					metrics_.bytesOut += nbytes;
+				}
+				setStatus(p->response->mutable_request_status(), ni::RequestStatusCode::SUCCESS, "");
+				row += p->batchSize;
+			}
+		}
+
+		//members
+		unsigned maxBatch_;
+		Clock::duration maxDelay_;
+		unsigned timeout_;
+		std::vector<std::unique_ptr<ni::GRPCService::Stub>> stubs_;
+		ShmRegistry shm_;
+		ProxyMetrics metrics_;
+
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::deque<Pending*> queue_;
+		bool stop_;
+		std::thread batcher_;
+
+		std::mutex readyMutex_;
+		std::condition_variable readyCv_;
+		std::deque<std::vector<Pending*>> ready_;
+		bool drained_;
+		std::vector<std::thread> workers_;
+		std::atomic<unsigned> sending_{0};
+};
+
+int main(int argc, char** argv) {
+	std::map<std::string, std::string> opts{
+		{"listen", "unix:/tmp/sonic.sock"},
+		{"upstream", ""},
+		{"connections", "4"},
+		{"max-batch", "16000"},
+		{"max-delay-us", "500"},
+		{"timeout", "300"},
+		{"metrics", ""},
+		{"metrics-interval", "10"},
+	};
+	for(int i = 1; i < argc; ++i){
+		const std::string arg(argv[i]);
+		if(arg.compare(0, 2, "--") != 0 or i+1 >= argc or opts.find(arg.substr(2)) == opts.end()){
+			std::cerr << "sonicProxy: bad argument " << arg << std::endl;
+			return 1;
+		}
+		opts[arg.substr(2)] = argv[++i];
+	}
+	if(opts["upstream"].empty()){
+		std::cerr << "sonicProxy: --upstream host:port is required" << std::endl;
+		return 1;
+	}
+
+	SonicProxy proxy(opts["upstream"], std::stoul(opts["connections"]), std::stoul(opts["max-batch"]), std::stoul(opts["max-delay-us"]), std::stoul(opts["timeout"]));
+
+	grpc::ServerBuilder builder;
+	builder.AddListeningPort(opts["listen"], grpc::InsecureServerCredentials());
+	builder.SetMaxReceiveMessageSize(-1);
+	builder.SetMaxSendMessageSize(-1);
+	builder.RegisterService(&proxy);
+	std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
+	if(!server){
+		std::cerr << "sonicProxy: unable to listen on " << opts["listen"] << std::endl;
+		return 1;
+	}
+	std::cout << "sonicProxy: " << opts["listen"] << " -> " << opts["upstream"] << " (" << opts["connections"] << " connections)" << std::endl;
+
+	std::signal(SIGINT, handleSignal);
+	std::signal(SIGTERM, handleSignal);
+	std::signal(SIGUSR1, handleDump);
+	const std::string metricsFile(opts["metrics"]);
+	const auto interval = std::chrono::seconds(std::stoul(opts["metrics-interval"]));
+	auto next = Clock::now() + interval;
+	while(!stopRequested){
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if(dumpRequested.exchange(false)) proxy.dump(std::cerr);
+		if(!metricsFile.empty() and Clock::now() >= next){
+			proxy.metrics().write(metricsFile);
+			next += interval;
+		}
+	}
+
+	server->Shutdown();
+	proxy.stop();
+	if(!metricsFile.empty()) proxy.metrics().write(metricsFile);
+	return 0;
+}
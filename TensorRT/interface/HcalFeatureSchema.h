@@ -0,0 +1,45 @@
+#ifndef SonicCMS_TensorRT_HcalFeatureSchema
+#define SonicCMS_TensorRT_HcalFeatureSchema
+
+#include "SonicCMS/Core/interface/SonicFeatureSchema.h"
+
+//input layouts for the HCAL models (one row per channel)
+
+//FACILE: iphi, gain, 8 time samples of raw charge, one-hot depth (1-7), one-hot |ieta| (0-29)
+struct FACILEFeatures {
+	struct Iphi : SonicFeature<1> {};
+	struct Gain : SonicFeature<1> {};
+	struct Charge : SonicFeature<8> {};
+	struct Depth : SonicOneHot<7,1> {};
+	struct Ieta : SonicOneHot<30,0> {};
+	typedef SonicFeatureSchema<Iphi,Gain,Charge,Depth,Ieta> Schema;
+};
+
+//FACILE with dense HB+HE layout: one row per channel in HcalTopology dense index order,
+//8 time samples of raw charge and a mask (1 if the channel was read out); geometry is implied by the row
+struct FACILEDenseFeatures {
+	struct Charge : SonicFeature<8> {};
+	struct Mask : SonicFeature<1> {};
+	typedef SonicFeatureSchema<Charge,Mask> Schema;
+};
+
+//HcalProducer: ieta, iphi, gain, 8 time samples of raw charge, one-hot depth (0-7)
+struct HcalProducerFeatures {
+	struct Ieta : SonicFeature<1> {};
+	struct Iphi : SonicFeature<1> {};
+	struct Gain : SonicFeature<1> {};
+	struct Charge : SonicFeature<8> {};
+	struct Depth : SonicOneHot<8,0> {};
+	typedef SonicFeatureSchema<Ieta,Iphi,Gain,Charge,Depth> Schema;
+};
+
+//HcalPhase1Reconstructor: ieta, iphi, 8 time samples of raw charge, one-hot depth (0-4)
+struct HcalPhase1Features {
+	struct Ieta : SonicFeature<1> {};
+	struct Iphi : SonicFeature<1> {};
+	struct Charge : SonicFeature<8> {};
+	struct Depth : SonicOneHot<5,0> {};
+	typedef SonicFeatureSchema<Ieta,Iphi,Charge,Depth> Schema;
+};
+
+#endif
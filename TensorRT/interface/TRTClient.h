@@ -2,12 +2,15 @@
 #define SonicCMS_TensorRT_TRTClient
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
-#include "SonicCMS/Core/interface/SonicClientSync.h"
-#include "SonicCMS/Core/interface/SonicClientPseudoAsync.h"
-#include "SonicCMS/Core/interface/SonicClientAsync.h"
+#include "SonicCMS/Core/interface/SonicClient.h"
+#include "SonicCMS/Core/interface/SonicMemory.h"
+#include "SonicCMS/TensorRT/interface/TRTTransport.h"
 
 #include <vector>
 #include <string>
+#include <map>
+#include <random>
+#include <chrono>
 
 #include "request_grpc.h"
 
@@ -25,25 +28,55 @@ struct ServerSideStats {
   std::map<ModelInfo, ServerSideStats> composing_models_stat;
 };
 
-template <typename Client>
-class TRTClient : public Client {
+//the mode (Sync, Async, PseudoAsync) is chosen with the "mode" parameter (see SonicClient.h)
+//the input and output buffers are allocated on the NUMA node of the stream, if configured (see SonicAffinity.h)
+class TRTClient : public SonicClient<SonicNumaVector<float>> {
 	public:
 		//constructor
 		TRTClient(const edm::ParameterSet& params);
+		//destructor: reports the per-version summary
+		~TRTClient() override;
 
-		//helper
+		//helpers
 		void getResults(const std::unique_ptr<nic::InferContext::Result>& result);
+		void getResults(TRTAsyncCall& call);
 
 		//accessors
 		unsigned ninput() const { return ninput_; }
 		unsigned noutput() const { return noutput_; }
+		const TRTTransport& transport() const { return transport_; }
 		unsigned batchSize() const { return batchSize_; }
+		unsigned maxBatchSize() const { return maxBatchSize_; }
+		//the batch size can be reduced for each request (e.g. if fewer rows are filled), up to the configured batchSize
+		void setBatchSize(unsigned bsize);
+		//model version used for the current request (-1 = latest)
+		int64_t version() const { return version_; }
 
 	protected:
 		void predictImpl() override;
-
+		//blocking (Sync and PseudoAsync modes) and non-blocking (Async mode) requests
+		void predictBlocking();
+		void predictAsync();
+		//inference and status contexts for the configured model version, and the transport resources
+		void initializeImpl() override;
+
+		//check the model input metadata against the configured row width (when the contexts for a version are created)
+		void checkInput(const nic::InferContext& context) const;
 		//helper for common ops
 		void setup();
+		//fill the request for the shared completion engine; returns the number of encoded bytes
+		size_t encodeRequest();
+		//copy the output rows (row(ib) points to the output of batch entry ib), after parse() (if the response still has to be parsed)
+		template <typename F, typename P = void (*)()>
+		void decode(const F& row, const P& parse = [](){});
+		//pick the model version for the next request
+		void selectVersion();
+		//contexts for a model version (created when it is first used)
+		void selectContexts(int64_t version);
+		//per-version bookkeeping and tracing for each completed request
+		void recordRemoteTime(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end);
+		//server-side spans inside the remote span (when the statistics cover exactly this request)
+		void traceServerSide(const ServerSideStats& stats, std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end);
 
 		void ReportServerSideState(const ServerSideStats& stats);
 		void SummarizeServerStats(
@@ -62,22 +95,57 @@ class TRTClient : public Client {
 			std::map<std::string, ni::ModelStatus>* model_status);
 
 		//members
-		std::string url_;
+		TRTTransport transport_;
 		unsigned timeout_;
 		std::string modelName_;
 		unsigned batchSize_;
+		unsigned maxBatchSize_;
 		unsigned ninput_;
 		unsigned noutput_;
-		std::unique_ptr<nic::InferContext> context_;
-		std::unique_ptr<nic::ServerStatusContext> server_ctx_;
+		//inference and status contexts for each model version, and those of the current request
+		struct Contexts {
+			std::unique_ptr<nic::InferContext> infer;
+			std::unique_ptr<nic::ServerStatusContext> status;
+		};
+		std::map<int64_t, Contexts> contexts_;
+		nic::InferContext* context_ = nullptr;
+		nic::ServerStatusContext* server_ctx_ = nullptr;
 		std::shared_ptr<nic::InferContext::Input> nicinput_; 
 
+		//asynchronous requests over grpc or unix can use the shared completion engine instead of the client library ("completion" parameter)
+		bool engine_;
+		//on the engine, the input tensor is sent by reference instead of being copied into the request ("zeroCopy" parameter, default true)
+		bool zeroCopy_;
+		TRTAsyncCall call_;
+
+		//bytes of the current request and its response
+		SonicClientMetrics::Payload request_, response_;
+		//memory held by the transport (tensor copies in the request and result, shared memory region) and the server status
+		SonicMemoryGauge memTransport_, memStatus_;
+
+		//version routing: requests go to modelVersion_ (-1 = latest),
+		//or to canaryVersion_ (if set) with probability canaryFraction_
+		int64_t modelVersion_;
+		int64_t canaryVersion_;
+		double canaryFraction_;
+		int64_t version_;
+		std::mt19937 rng_;
+		std::uniform_real_distribution<double> uniform_;
+		struct VersionStats {
+			unsigned long requests = 0;
+			unsigned long rows = 0;
+			unsigned long remoteUs = 0;
+			unsigned long wireBytes = 0;
+		};
+		std::map<int64_t, VersionStats> versionStats_;
+
+		//server statistics at the start and end of the window of the current request (the window starts when the previous request ended)
 		std::map<std::string, ni::ModelStatus> start_status, end_status;
-};
 
-typedef TRTClient<SonicClientSync<std::vector<float>>> TRTClientSync;
-typedef TRTClient<SonicClientPseudoAsync<std::vector<float>>> TRTClientPseudoAsync;
-typedef TRTClient<SonicClientAsync<std::vector<float>>> TRTClientAsync;
+		//response of the current asynchronous request, stored by the callback for the completion task
+		std::map<std::string, std::unique_ptr<nic::InferContext::Result>> asyncResults_;
+		std::chrono::high_resolution_clock::time_point tReceived_;
+};
 
 #endif
 
@@ -0,0 +1,114 @@
+#ifndef SonicCMS_TensorRT_TRTTransport
+#define SonicCMS_TensorRT_TRTTransport
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "SonicCMS/Core/interface/SonicAsyncEngine.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "request_grpc.h"
+#include "request_http.h"
+#include "grpc_service.grpc.pb.h"
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/generic/generic_stub.h>
+
+namespace nic = nvidia::inferenceserver::client;
+namespace ni = nvidia::inferenceserver;
+
+//one inference call on the shared completion engine
+//the messages and buffers are reused for every request of a client (after the first requests, no protobuf allocations are needed),
+//and the input tensor can be sent by reference: it is then not in the request message, but appended to the serialized header as a separate slice
+struct TRTAsyncCall : public SonicAsyncCall {
+	void complete(bool ok) override { done(ok); }
+
+	//a context can only be used for one call
+	std::unique_ptr<grpc::ClientContext> context;
+	//header (model, metadata), and the tensor if it is copied
+	ni::InferRequest request;
+	//tensor sent by reference (must stay valid until the call completes; nullptr = in the request)
+	const void* tensor = nullptr;
+	size_t tensorBytes = 0;
+	ni::InferResponse response;
+	std::string header;
+	grpc::ByteBuffer sendBuffer, receiveBuffer;
+	grpc::Status status;
+	std::unique_ptr<grpc::GenericClientAsyncResponseReader> reader;
+	std::function<void(bool)> done;
+};
+
+typedef SonicAsyncEngine<grpc::CompletionQueue> TRTAsyncEngine;
+
+//transport layer used by TRTClient, selected by the "transport" client parameter (default "grpc"):
+//	grpc: gRPC to address:port
+//	grpcStream: gRPC bidirectional stream, which avoids setting up a new call for each request
+//	http: HTTP/REST with binary tensor payloads to address:port (usually the server's HTTP port)
+//	unix: gRPC over a Unix domain socket, address is the socket path (port is ignored)
+//	shm: tensors are exchanged through a POSIX shared memory region registered with a server on the same node,
+//	     control messages use gRPC to address:port (or to address, if it is a unix: socket)
+//an in-process backend is not provided by the v1 client library, so it is not supported
+//asynchronous requests over grpc and unix can bypass the client library and use the shared completion engine (startCall())
+class TRTTransport {
+	public:
+		enum class Type { Grpc, GrpcStream, Http, Unix, SharedMemory };
+
+		//constructor
+		TRTTransport(const edm::ParameterSet& params);
+		~TRTTransport();
+		//owns the shared memory region, if any
+		TRTTransport(const TRTTransport&) = delete;
+		TRTTransport& operator=(const TRTTransport&) = delete;
+
+		//contexts for inference (modelVersion -1 = latest) and server status
+		void createContexts(const std::string& modelName, int64_t modelVersion, std::unique_ptr<nic::InferContext>* context, std::unique_ptr<nic::ServerStatusContext>* serverContext) const;
+		//reserve space for the largest request (only needed for shared memory)
+		void prepare(size_t inputBytes, size_t outputBytes);
+		//input rows are contiguous in data; returns the number of encoded bytes
+		size_t setInput(nic::InferContext::Input& input, const float* data, unsigned batchSize, unsigned rowSize);
+		void addOutput(nic::InferContext::Options& options, const std::shared_ptr<nic::InferContext::Output>& output, unsigned batchSize, unsigned rowSize) const;
+		//output row for batch entry ib
+		const float* getOutput(nic::InferContext::Result& result, unsigned ib, unsigned rowSize) const;
+		//estimated bytes on the wire for one message with one tensor of tensorBytes and other fields (names, shapes) of metadataBytes:
+		//protobuf field headers, gRPC message prefix, and HTTP/2 DATA frame headers are included;
+		//HTTP/2 HEADERS frames, HTTP/1.1 headers, and TCP/IP headers are not
+		uint64_t wireBytes(uint64_t tensorBytes, uint64_t metadataBytes) const;
+
+		//shared completion engine: only for the plain gRPC transports
+		bool supportsEngine() const { return type_ == Type::Grpc or type_ == Type::Unix; }
+		//create the stub for the engine (done by startCall() if needed); the channel is shared by all clients with the same url
+		void connect();
+		//send call.request (and call.tensor) on the engine (call.done is called on an engine thread); timeout in seconds (0 = none)
+		void startCall(TRTAsyncCall& call, unsigned timeout);
+		//check the status and parse call.response (after call.done)
+		void finishCall(TRTAsyncCall& call) const;
+		//output row for batch entry ib of a response received on the engine
+		const float* getOutput(const ni::InferResponse& response, unsigned ib, unsigned rowSize) const;
+
+		//accessors
+		Type type() const { return type_; }
+		const std::string& name() const { return name_; }
+		const std::string& url() const { return url_; }
+		//size of the shared memory region (0 if none)
+		size_t sharedMemoryBytes() const { return inputBytes_ + outputBytes_; }
+
+	private:
+		void releaseSharedMemory();
+
+		//members
+		Type type_;
+		std::string name_;
+		std::string url_;
+		//for the shared completion engine (created on first use)
+		std::unique_ptr<grpc::GenericStub> stub_;
+
+		//shared memory region: input at the start, output after inputBytes_
+		std::string shmKey_;
+		std::unique_ptr<nic::SharedMemoryControlContext> shmContext_;
+		uint8_t* shmRegion_;
+		size_t inputBytes_;
+		size_t outputBytes_;
+};
+
+#endif
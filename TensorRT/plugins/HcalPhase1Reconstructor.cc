@@ -29,7 +29,9 @@
 #include "FWCore/Framework/interface/ConsumesCollector.h"
 
 #include "SonicCMS/Core/interface/SonicEDProducer.h"
+#include "SonicCMS/Core/interface/SonicLog.h"
 #include "SonicCMS/TensorRT/interface/TRTClient.h"
+#include "SonicCMS/TensorRT/interface/HcalFeatureSchema.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Framework/interface/EventSetup.h"
@@ -121,13 +123,14 @@ namespace {
 }
 
 template <typename Client>
-class HcalPhase1Reconstructor : public SonicEDProducer<Client>
+class HcalPhase1ReconstructorT : public SonicEDProducer<Client>
 {
 	public:
 		//needed because base class has dependent scope
 		using typename SonicEDProducer<Client>::Input;
 		using typename SonicEDProducer<Client>::Output;
-		explicit HcalPhase1Reconstructor(edm::ParameterSet const& cfg) : 
+		typedef HcalPhase1Features::Schema Schema;
+		explicit HcalPhase1ReconstructorT(edm::ParameterSet const& cfg) : 
 			SonicEDProducer<Client>(cfg), 
 			sipmQTSShift_(cfg.getParameter<unsigned>("sipmQTSShift")),
 			sipmQNTStoSum_(cfg.getParameter<unsigned>("sipmQNTStoSum")), 
@@ -144,12 +147,13 @@ class HcalPhase1Reconstructor : public SonicEDProducer<Client>
 			this->template produces<HBHERecHitCollection>();
 			//for debugging
 			this->setDebugName("HcalProducer");
+			Schema::check(client_.ninput(), "HcalPhase1Reconstructor");
 		}
 		void acquire(edm::Event const& iEvent, edm::EventSetup const& iSetup, Input& iInput) override {
 
 			auto ninput = client_.ninput();
 			auto batchSize = client_.batchSize();
-			iInput = Input(ninput*batchSize, 0.f);
+			iInput.assign(ninput*batchSize, 0.f);
 
 			edm::Handle<QIE11DigiCollection> digis;
 			iEvent.getByToken(fTokDigis, digis);
@@ -173,13 +177,9 @@ class HcalPhase1Reconstructor : public SonicEDProducer<Client>
 			const bool skipDroppedChannels = false;
 
 			unsigned int ib = 0;
-    			std::cout << "# digis: " << std::distance(coll.begin(), coll.end()) << std::endl;
+    			SONIC_LOG("HcalPhase1Reconstructor", "# digis: {}", std::distance(coll.begin(), coll.end()));
 			for (typename Collection::const_iterator it = coll.begin(); it != coll.end(); it++){
 
-
-
-				unsigned int ib = std::distance(coll.begin(),it);
-
 			 	const DFrame& frame(*it);
 	        	  	const HcalDetId cell(frame.id());
 
@@ -202,26 +202,20 @@ class HcalPhase1Reconstructor : public SonicEDProducer<Client>
 			        const int maxTS = std::min(nRead, static_cast<int>(HBHEChannelInfo::MAXSAMPLES));
 
 				const int soi = 3;
-				const int nCycles = 8;
+				constexpr int nCycles = HcalPhase1Features::Charge::width;
 			        const RawChargeFromSample<DFrame> rcfs(sipmQTSShift_, sipmQNTStoSum_, 
                                                			       cond, cell, cs, soi, frame, maxTS);
 
-
-				
+				float* row = Schema::row(iInput, ib);
 				for (int inputTS = 0; inputTS < nCycles; ++inputTS){
-					auto s(frame[inputTS]);
-					const uint8_t adc = s.adc();
-					const int capid = s.capid();
+					const int capid = frame[inputTS].capid();
 				        const double rawCharge = rcfs.getRawCharge(cs[inputTS], calib.pedestal(capid));
-					iInput[ib*ninput+inputTS+2] = (float)rawCharge;
+					Schema::set<HcalPhase1Features::Charge>(row, inputTS, rawCharge);
 				}
 
-				iInput[ib + 0] = cell.ieta();
-				iInput[ib + 1] = cell.iphi();
-				for(unsigned int d = 1; d < 5; d++){
-					if(depth == (float)d) 	{ iInput[ib*ninput + d + 10] = 1.; }
-					else 			{ iInput[ib*ninput + d + 10] = 0.; }
-				}
+				Schema::set<HcalPhase1Features::Ieta>(row, cell.ieta());
+				Schema::set<HcalPhase1Features::Iphi>(row, cell.iphi());
+				Schema::encode<HcalPhase1Features::Depth>(row, cell.depth());
 				ib++;
 				HBHERecHit rh = HBHERecHit(cell, 0.f,0.f,0.f);
 				tmp->push_back(rh);
@@ -243,7 +237,7 @@ class HcalPhase1Reconstructor : public SonicEDProducer<Client>
 
 			iEvent.put(std::move(out));
 		}
-		~HcalPhase1Reconstructor() override {}
+		~HcalPhase1ReconstructorT() override {}
 
 	private:
 
@@ -263,18 +257,13 @@ class HcalPhase1Reconstructor : public SonicEDProducer<Client>
                 std::vector<HBHERecHit> tmprh;
 		std::vector<HBHERecHit> *tmp = &tmprh;
 		
-		float depth, ieta, iphi; 
-
 		using SonicEDProducer<Client>::client_;
 		//Just putting something in for the hell of it
 
 };
 
 
-typedef HcalPhase1Reconstructor<TRTClientSync> HcalPhase1ReconstructorSync;
-typedef HcalPhase1Reconstructor<TRTClientAsync> HcalPhase1ReconstructorAsync;
-typedef HcalPhase1Reconstructor<TRTClientPseudoAsync> HcalPhase1ReconstructorPseudoAsync;
+//the client mode is selected by the "mode" parameter of the Client PSet
+typedef HcalPhase1ReconstructorT<TRTClient> HcalPhase1Reconstructor;
 
-DEFINE_FWK_MODULE(HcalPhase1ReconstructorSync);
-DEFINE_FWK_MODULE(HcalPhase1ReconstructorAsync);
-DEFINE_FWK_MODULE(HcalPhase1ReconstructorPseudoAsync);
+DEFINE_FWK_MODULE(HcalPhase1Reconstructor);
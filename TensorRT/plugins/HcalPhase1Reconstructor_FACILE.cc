@@ -6,16 +6,23 @@
 #include <utility>
 #include <algorithm>
 #include <fstream>
+#include <chrono>
 #include "Geometry/CaloGeometry/interface/CaloSubdetectorGeometry.h"
 #include "Geometry/CaloGeometry/interface/CaloGeometry.h"
 #include "Geometry/CaloGeometry/interface/CaloCellGeometry.h"
 #include "Geometry/Records/interface/CaloGeometryRecord.h"
+#include "Geometry/Records/interface/HcalRecNumberingRecord.h"
 #include "Geometry/CaloTopology/interface/HcalTopology.h"
 #include "Geometry/HcalCommonData/interface/HcalHitRelabeller.h"
 #include "DataFormats/HcalRecHit/interface/HcalRecHitCollections.h"
 #include "DataFormats/HcalRecHit/interface/HcalRecHitDefs.h"
 #include "EventFilter/HcalRawToDigi/interface/HcalPacker.h"
+#include "EventFilter/HcalRawToDigi/interface/HcalUHTRData.h"
+#include "EventFilter/HcalRawToDigi/interface/AMC13Header.h"
 #include "DataFormats/FEDRawData/interface/FEDRawDataCollection.h"
+#include "DataFormats/FEDRawData/interface/FEDNumbering.h"
+#include "DataFormats/HcalDetId/interface/HcalElectronicsId.h"
+#include "CondFormats/HcalObjects/interface/HcalElectronicsMap.h"
 #include "DataFormats/HcalDetId/interface/HcalGenericDetId.h"
 #include "DataFormats/HcalDigi/interface/HcalDigiCollections.h"
 #include "DataFormats/METReco/interface/HcalPhase1FlagLabels.h"
@@ -30,7 +37,10 @@
 #include "FWCore/Framework/interface/ConsumesCollector.h"
 
 #include "SonicCMS/Core/interface/SonicEDProducer.h"
+#include "SonicCMS/Core/interface/SonicLog.h"
+#include "SonicCMS/Core/interface/SonicClientSharded.h"
 #include "SonicCMS/TensorRT/interface/TRTClient.h"
+#include "SonicCMS/TensorRT/interface/HcalFeatureSchema.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Framework/interface/EventSetup.h"
@@ -111,134 +121,321 @@ namespace {
         double factor_;
     };
 
+    //uniform access to the shards of a sharded client (a plain client is a single shard)
+    template<class C> unsigned nShards(const C&) { return 1; }
+    template<class C> unsigned nShards(const SonicClientSharded<C>& c) { return c.nshards(); }
+    template<class C> C& shardClient(C& c, unsigned) { return c; }
+    template<class C> C& shardClient(SonicClientSharded<C>& c, unsigned i) { return c.shard(i); }
+    inline TRTClient::Input& shardBuffer(TRTClient::Input& in, unsigned) { return in; }
+    inline TRTClient::Input& shardBuffer(std::vector<TRTClient::Input*>& in, unsigned i) { return *in[i]; }
+    inline const TRTClient::Output& shardBuffer(const TRTClient::Output& out, unsigned) { return out; }
+    inline const TRTClient::Output& shardBuffer(const std::vector<const TRTClient::Output*>& out, unsigned i) { return *out[i]; }
 }
 
 template <typename Client>
-class HcalPhase1Reconstructor_FACILE : public SonicEDProducer<Client>
+class HcalPhase1Reconstructor_FACILET : public SonicEDProducer<Client>
 {
 	public:
 		//needed because base class has dependent scope
 		using typename SonicEDProducer<Client>::Input;
 		using typename SonicEDProducer<Client>::Output;
-		explicit HcalPhase1Reconstructor_FACILE(edm::ParameterSet const& cfg) : 
+		typedef FACILEFeatures::Schema Schema;
+		typedef FACILEDenseFeatures::Schema DenseSchema;
+		static_assert(FACILEDenseFeatures::Charge::width == FACILEFeatures::Charge::width, "layouts must use the same number of samples");
+		explicit HcalPhase1Reconstructor_FACILET(edm::ParameterSet const& cfg) : 
 			SonicEDProducer<Client>(cfg), 
 			sipmQTSShift_(cfg.getParameter<unsigned>("sipmQTSShift")),
 			sipmQNTStoSum_(cfg.getParameter<unsigned>("sipmQNTStoSum")), 
 			topN_(cfg.getParameter<unsigned>("topN")),  
+			unpackRaw_(cfg.getParameter<bool>("unpackRaw")),
+			denseLayout_(cfg.getParameter<bool>("denseLayout")),
+			zeroSuppress_(cfg.getParameter<bool>("zeroSuppress")),
+			zsThreshold_(cfg.getParameter<double>("zsThreshold")),
+			zsEnergy_(cfg.getParameter<double>("zsEnergy")),
+			zsLocalEnergy_(cfg.getParameter<bool>("zsLocalEnergy")),
+			energyScale_(cfg.getParameter<double>("energyScale")),
+			energyMin_(cfg.getParameter<double>("energyMin")),
+			energyMax_(cfg.getParameter<double>("energyMax")),
 			fDigiName(cfg.getParameter<edm::InputTag>("digiLabelQIE11")),
+			fRawName(cfg.getParameter<edm::InputTag>("fedRawDataLabel")),
 			fRHName(cfg.getParameter<edm::InputTag>("edmRecHitName")),   
 			fChanInfoName(cfg.getParameter<edm::InputTag>("edmChanInfoName")), 
 			fTokRH(this->template consumes<edm::SortedCollection<HBHERecHit,edm::StrictWeakOrdering<HBHERecHit>> >(fRHName)), 
-			fTokChanInfo(this->template consumes<edm::SortedCollection<HBHEChannelInfo,edm::StrictWeakOrdering<HBHEChannelInfo>> >(fChanInfoName)),
-			fTokDigis(this->template consumes<QIE11DigiCollection>(fDigiName))
+			fTokChanInfo(this->template consumes<edm::SortedCollection<HBHEChannelInfo,edm::StrictWeakOrdering<HBHEChannelInfo>> >(fChanInfoName))
 		{
-
+			//raw mode does not depend on the unpacked digis at all
+			if(unpackRaw_) fTokRaw = this->template consumes<FEDRawDataCollection>(fRawName);
+			else fTokDigis = this->template consumes<QIE11DigiCollection>(fDigiName);
+
+			const unsigned nshards = nShards(client_);
+			if(nshards > 1 && denseLayout_)
+				throw cms::Exception("Configuration") << "shards cannot be used with denseLayout (which has a fixed shape)";
+
+			//assign channels to shards by subdetector and |ieta| range (first match wins)
+			shardMap_.assign(kNSubdet*kNIeta, nshards > 1 ? -1 : 0);
+			if(nshards > 1){
+				const auto& shardParams = cfg.getParameter<edm::ParameterSet>("Client").getParameter<std::vector<edm::ParameterSet>>("shards");
+				for(unsigned s = 0; s < nshards; ++s){
+					const unsigned ietaMin = shardParams[s].getParameter<unsigned>("absIetaMin");
+					const unsigned ietaMax = std::min(shardParams[s].getParameter<unsigned>("absIetaMax"), kNIeta-1);
+					for(auto subdet : shardParams[s].getParameter<std::vector<unsigned>>("subdets")){
+						if(subdet >= kNSubdet) continue;
+						for(unsigned ieta = ietaMin; ieta <= ietaMax; ++ieta){
+							if(shardMap_[subdet*kNIeta+ieta] < 0) shardMap_[subdet*kNIeta+ieta] = s;
+						}
+					}
+				}
+			}
 
 			this->template produces<HBHERecHitCollection>();
 			this->setDebugName("HcalPhase1Reconstructor_FACILE");
+			for(unsigned s = 0; s < nshards; ++s){
+				if(denseLayout_) DenseSchema::check(shardClient(client_, s).ninput(), "HcalPhase1Reconstructor_FACILE");
+				else Schema::check(shardClient(client_, s).ninput(), "HcalPhase1Reconstructor_FACILE");
+			}
 		}
 		void acquire(edm::Event const& iEvent, edm::EventSetup const& iSetup, Input& iInput) override {
 
-			auto ninput = client_.ninput();
-			auto batchSize = client_.batchSize();
-			iInput = Input(ninput*batchSize, 0.f);
+			const unsigned nshards = nShards(client_);
+			if(denseLayout_){
+				edm::ESHandle<HcalTopology> topology;
+				iSetup.get<HcalRecNumberingRecord>().get(topology);
+				topo_ = topology.product();
+			}
 
-			edm::Handle<QIE11DigiCollection> digis;
-			iEvent.getByToken(fTokDigis, digis);
+			nrows_.assign(nshards, 0);
+			for(unsigned s = 0; s < nshards; ++s){
+				auto& shard = shardClient(client_, s);
+				auto& buffer = shardBuffer(iInput, s);
+				shard.setBatchSize(shard.maxBatchSize());
+				auto ninput = shard.ninput();
+				auto batchSize = shard.batchSize();
+				if(denseLayout_){
+					const unsigned nDense = topo_->getHBSize() + topo_->getHESize();
+					if(batchSize != nDense)
+						throw cms::Exception("BadBatch") << "dense layout needs batchSize = " << nDense << " (HB+HE channels), but client has " << batchSize;
+					//persistent buffer: allocate once, then only reset the rows filled in the previous event
+					if(buffer.size() != ninput*batchSize) buffer.assign(ninput*batchSize, 0.f);
+					else {
+						for(auto row : rows_){
+							if(row != kSuppressed) std::fill_n(DenseSchema::row(buffer, row), DenseSchema::size, 0.f);
+						}
+					}
+				}
+				else buffer.assign(ninput*batchSize, 0.f);
+			}
 
 			edm::ESHandle<HcalDbService> conditions;
 			iSetup.get<HcalDbRecord>().get(conditions);
 
-			tmp->clear();
+			ids_.clear();
+			energies_.clear();
+			rows_.clear();
+			shardOf_.clear();
 
-		        processData<QIE11DataFrame>(*digis, *conditions, iInput, ninput);
-			
+			if(unpackRaw_){
+				edm::Handle<FEDRawDataCollection> raw;
+				iEvent.getByToken(fTokRaw, raw);
+				processRaw(*raw, *conditions, iInput);
+			}
+			else {
+				edm::Handle<QIE11DigiCollection> digis;
+				iEvent.getByToken(fTokDigis, digis);
+				processData<QIE11DataFrame>(*digis, *conditions, iInput);
+			}
+
+			for(unsigned s = 0; s < nshards; ++s){
+				//only send the filled rows (the dense layout has a fixed shape)
+				if(!denseLayout_) shardClient(client_, s).setBatchSize(std::max(nrows_[s], 1u));
+			}
 		}
 
 		template<class DFrame, class Collection>
 		void processData(const Collection& coll,
                                  const HcalDbService& cond,
-				 Input& iInput,
-				 auto ninput)
+				 Input& iInput)
 		{
-
-			const bool skipDroppedChannels = false;
-
-			unsigned int ib = 0;
 			for (typename Collection::const_iterator it = coll.begin(); it != coll.end(); it++){
+				fillChannel<DFrame>(*it, cond, iInput);
+			}
+		}
 
+		//decode QIE11 frames directly from the uHTR payloads and fill the input in the same pass
+		//(same traversal as HcalUnpacker::unpackUTCA, but without building a digi collection)
+		void processRaw(const FEDRawDataCollection& raw,
+				const HcalDbService& cond,
+				Input& iInput)
+		{
+			const HcalElectronicsMap* emap = cond.getHcalMapping();
+			for (int fed = FEDNumbering::MINHCALuTCAFEDID; fed <= FEDNumbering::MAXHCALuTCAFEDID; ++fed){
+				const FEDRawData& fedData = raw.FEDData(fed);
+				if (fedData.size() < 24) continue;
+
+				const hcal::AMC13Header* amc13 = reinterpret_cast<const hcal::AMC13Header*>(fedData.data());
+				for (int iamc = 0; iamc < amc13->NAMC(); ++iamc){
+					HcalUHTRData uhtr(amc13->AMCPayload(iamc), amc13->AMCSize(iamc));
+					const int crate = uhtr.crateId();
+					const int slot = uhtr.slot();
+
+					HcalUHTRData::const_iterator i = uhtr.begin(), iend = uhtr.end();
+					while (i != iend){
+						if (!i.isHeader() || i.flavor() != kFlavorQIE11) { ++i; continue; }
+
+						const HcalElectronicsId eid(crate, slot, (i.channelid() >> 3) & 0x1F, i.channelid() & 0x7, false);
+						const DetId did = emap->lookup(eid);
+
+						//copy header and samples into a reused scratch frame, plus an empty flag word
+						frameWords_.clear();
+						frameWords_.push_back(*i);
+						for (++i; i != iend && !i.isHeader(); ++i) frameWords_.push_back(*i);
+						frameWords_.push_back(0);
+
+						//QIE11 frames are only expected from HB and HE: anything else is not decoded as QIE11
+						if (did.null() || did.det() != DetId::Hcal) continue;
+						const HcalSubdetector subdet = HcalDetId(did).subdet();
+						if (subdet != HcalSubdetector::HcalBarrel && subdet != HcalSubdetector::HcalEndcap) {
+							SONIC_LOG("HcalPhase1Reconstructor_FACILE", "Skipping QIE11 frame for non-HB/HE channel {}", did.rawId());
+							continue;
+						}
+						const QIE11DataFrame frame(edm::DataFrame(did.rawId(), frameWords_.data(), frameWords_.size()));
+						fillChannel<QIE11DataFrame>(frame, cond, iInput);
+					}
+				}
+			}
+		}
 
+		//fill the next row of the channel's shard from one frame (unless the channel is not used or is zero-suppressed)
+		template<class DFrame>
+		void fillChannel(const DFrame& frame,
+				 const HcalDbService& cond,
+				 Input& iInput)
+		{
+	        	const HcalDetId cell(frame.id());
+
+        	   	const HcalSubdetector subdet = cell.subdet();
+        		if (!(subdet == HcalSubdetector::HcalBarrel ||
+	   		      subdet == HcalSubdetector::HcalEndcap ||
+    		              subdet == HcalSubdetector::HcalOuter))
+        	    		return;
+
+			//truncated frames (e.g. from corrupted raw data) do not have all the samples that are read below
+			constexpr int nCycles = FACILEFeatures::Charge::width;
+			if (frame.samples() < nCycles) {
+				SONIC_LOG("HcalPhase1Reconstructor_FACILE", "Skipping channel {} with {} samples", cell.rawId(), frame.samples());
+				return;
+			}
 
-				unsigned int ib = std::distance(coll.begin(),it);
-
-			 	const DFrame& frame(*it);
-	        	  	const HcalDetId cell(frame.id());
-
-        		   	const HcalSubdetector subdet = cell.subdet();
-        			if (!(subdet == HcalSubdetector::HcalBarrel ||
-	   			      subdet == HcalSubdetector::HcalEndcap ||
-    			              subdet == HcalSubdetector::HcalOuter))
-        		    	continue;
+			const unsigned int absIeta = std::abs(cell.ieta());
+			const int ishard = absIeta < kNIeta ? shardMap_[subdet*kNIeta+absIeta] : -1;
+			if (ishard < 0)
+				throw cms::Exception("Configuration") << "no shard for channel " << cell;
+			auto& shard = shardClient(client_, ishard);
+			auto& buffer = shardBuffer(iInput, ishard);
+
+			//row in the input: next free row, or fixed position given by the dense channel index
+			unsigned int irow = nrows_[ishard];
+			if (denseLayout_) {
+				if (subdet == HcalSubdetector::HcalOuter) return;
+				irow = topo_->detId2denseId(cell);
+			}
+			if (irow >= shard.batchSize())
+				throw cms::Exception("BadBatch") << "more HCAL channels than batchSize = " << shard.batchSize();
 		
-				const HcalCalibrations& calib = cond.getHcalCalibrations(cell);
-			        const HcalQIECoder* channelCoder = cond.getHcalCoder(cell);
-			        const HcalQIEShape* shape = cond.getHcalShape(channelCoder);
-			        const HcalCoderDb coder(*channelCoder, *shape);
-
-				CaloSamples cs;
-        			coder.adc2fC(frame, cs);
-
-
-				const int nRead = cs.size();
-			        const int maxTS = std::min(nRead, static_cast<int>(HBHEChannelInfo::MAXSAMPLES));
-
-				const int soi = 3;
-				const int nCycles = 8;
-			        const RawChargeFromSample<DFrame> rcfs(sipmQTSShift_, sipmQNTStoSum_, 
-                                               			       cond, cell, cs, soi, frame, maxTS);
-
+			const HcalCalibrations& calib = cond.getHcalCalibrations(cell);
+		        const HcalQIECoder* channelCoder = cond.getHcalCoder(cell);
+		        const HcalQIEShape* shape = cond.getHcalShape(channelCoder);
+		        const HcalCoderDb coder(*channelCoder, *shape);
+
+			CaloSamples cs;
+        		coder.adc2fC(frame, cs);
+
+			const int nRead = cs.size();
+		        const int maxTS = std::min(nRead, static_cast<int>(HBHEChannelInfo::MAXSAMPLES));
+
+			const int soi = 3;
+		        const RawChargeFromSample<DFrame> rcfs(sipmQTSShift_, sipmQNTStoSum_, 
+                                               		       cond, cell, cs, soi, frame, maxTS);
+
+			float charge[nCycles];
+			float pedestal[nCycles];
+			int capid = 0;
+			for (int inputTS = 0; inputTS < nCycles; ++inputTS){
+				capid = frame[inputTS].capid();
+				pedestal[inputTS] = calib.pedestal(capid);
+				charge[inputTS] = rcfs.getRawCharge(cs[inputTS], pedestal[inputTS]);
+			}
 
-				iInput[ib*ninput + 0] = (float)cell.iphi();
-				for (int inputTS = 0; inputTS < nCycles; ++inputTS){
-					auto s(frame[inputTS]);
-					const uint8_t adc = s.adc();
-					const int capid = s.capid();
-			        	const double gain = calib.respcorrgain(capid);	
-					iInput[ib*ninput + 1] = (float)gain;
-				        const double rawCharge = rcfs.getRawCharge(cs[inputTS], calib.pedestal(capid));
-					iInput[ib*ninput+inputTS+2] = ((float)rawCharge);
-				}
-				for(unsigned int d = 1; d < 8; d++){
-					if(cell.depth() == (float)d) 	{ iInput[ib*ninput + d + 9] = 1.; }
-					else 				{ iInput[ib*ninput + d + 9] = 0.; }
-				}
-				for(unsigned int d = 0; d < 30; d++){
-					if(std::abs(cell.ieta()) == (float)d) 	{ iInput[ib*ninput + d + 17] = 1.; }
-					else 					{ iInput[ib*ninput + d + 17] = 0.; }
+			if (zeroSuppress_) {
+				//total charge above pedestal (fixed trip count, no branches)
+				float sumQ = 0.f;
+				for (int inputTS = 0; inputTS < nCycles; ++inputTS) sumQ += charge[inputTS] - pedestal[inputTS];
+				if (sumQ < zsThreshold_) {
+					//channel is not sent: energy is a constant, or the charge above pedestal times the gain
+					const float energy = zsLocalEnergy_ ? std::max(sumQ*float(calib.respcorrgain(capid)), float(zsEnergy_)) : float(zsEnergy_);
+					ids_.push_back(cell);
+					energies_.push_back(energy);
+					rows_.push_back(kSuppressed);
+					shardOf_.push_back(ishard);
+					return;
 				}
-				ib++;
-				HBHERecHit rh = HBHERecHit(cell, 0.f,0.f,0.f);
-				tmp->push_back(rh);
 			}
-		}
-		void produce(edm::Event& iEvent, edm::EventSetup const& iSetup, Output const& iOutput) override {
 
+			if (denseLayout_) {
+				//position, depth, and gain are implied by the row
+				float* row = DenseSchema::row(buffer, irow);
+				DenseSchema::copy<FACILEDenseFeatures::Charge>(row, charge);
+				DenseSchema::set<FACILEDenseFeatures::Mask>(row, 1);
+			}
+			else {
+				//gain is taken from the capacitor of the last sample
+				float* row = Schema::row(buffer, irow);
+				Schema::set<FACILEFeatures::Iphi>(row, cell.iphi());
+				Schema::set<FACILEFeatures::Gain>(row, calib.respcorrgain(capid));
+				Schema::copy<FACILEFeatures::Charge>(row, charge);
+				Schema::encode<FACILEFeatures::Depth>(row, cell.depth());
+				Schema::encode<FACILEFeatures::Ieta>(row, std::abs(cell.ieta()));
+			}
 
-  			std::unique_ptr<HBHERecHitCollection> out;
-			out = std::make_unique<HBHERecHitCollection>();
+			ids_.push_back(cell);
+			energies_.push_back(0.f);
+			rows_.push_back(irow);
+			shardOf_.push_back(ishard);
+			++nrows_[ishard];
+		}
 
-			unsigned int ib = 0;
-			for(HBHERecHitCollection::const_iterator it = tmp->begin(); it != tmp->end(); it++){
+		void produce(edm::Event& iEvent, edm::EventSetup const& iSetup, Output const& iOutput) override {
+			auto t0 = std::chrono::high_resolution_clock::now();
+			const unsigned int nhits = ids_.size();
+
+			//gather, calibrate, and clamp the model outputs in one pass (suppressed channels already have their final energy)
+			const float scale = energyScale_;
+			const float emin = energyMin_;
+			const float emax = energyMax_;
+			float* energies = energies_.data();
+			for(unsigned int ib = 0; ib < nhits; ++ib){
+				if (rows_[ib] != kSuppressed) energies[ib] = std::min(std::max(shardBuffer(iOutput, shardOf_[ib])[rows_[ib]]*scale, emin), emax);
+			}
 
-				float rh_e = iOutput[ib];
-				if (rh_e < 0.01) rh_e = 0.01;
-				else if (rh_e > 1000.) rh_e = 1000.;
-				HBHERecHit rhout = HBHERecHit(it->id(),rh_e,0.f,0.f);
-				out->push_back(rhout); ib++;
+			//channels are kept in input order: sorted for the digi collection, in FED order in raw mode;
+			//the event sorts the collection when it is put (SortedCollection::post_insert), so it is not sorted here
+			std::vector<HBHERecHit> hits;
+			hits.reserve(nhits);
+			for(unsigned int ib = 0; ib < nhits; ++ib){
+				hits.emplace_back(ids_[ib], energies[ib], 0.f, 0.f);
 			}
+			auto out = std::make_unique<HBHERecHitCollection>();
+			out->swap_contents(hits);
 			iEvent.put(std::move(out));
+
+			//buffers reused between events
+			uint64_t scratchBytes = sonic_memory::bytes(frameWords_) + sonic_memory::bytes(ids_) + sonic_memory::bytes(energies_)
+				+ sonic_memory::bytes(rows_) + sonic_memory::bytes(shardOf_) + sonic_memory::bytes(nrows_);
+			this->setProducerMemory(scratchBytes);
+
+			auto t1 = std::chrono::high_resolution_clock::now();
+			SONIC_LOG("HcalPhase1Reconstructor_FACILE", "Produce time: {}", std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
 		}
-		~HcalPhase1Reconstructor_FACILE() override {}
+		~HcalPhase1Reconstructor_FACILET() override {}
 
 	private:
 
@@ -247,15 +444,43 @@ class HcalPhase1Reconstructor_FACILE : public SonicEDProducer<Client>
 		int sipmQTSShift_;
 		int sipmQNTStoSum_;
 		unsigned topN_;
+		bool unpackRaw_;
+		bool denseLayout_;
+		bool zeroSuppress_;
+		double zsThreshold_;
+		double zsEnergy_;
+		bool zsLocalEnergy_;
+		double energyScale_;
+		double energyMin_;
+		double energyMax_;
 	  	edm::InputTag fDigiName;
+		edm::InputTag fRawName;
     		edm::InputTag fRHName;
     		edm::InputTag fChanInfoName;
    		edm::EDGetTokenT<edm::SortedCollection<HBHERecHit,edm::StrictWeakOrdering<HBHERecHit>>> fTokRH;
     		edm::EDGetTokenT<edm::SortedCollection<HBHEChannelInfo,edm::StrictWeakOrdering<HBHEChannelInfo>>> fTokChanInfo;
  		edm::EDGetTokenT<QIE11DigiCollection> fTokDigis;
-
-                std::vector<HBHERecHit> tmprh;
-		std::vector<HBHERecHit> *tmp = &tmprh;
+		edm::EDGetTokenT<FEDRawDataCollection> fTokRaw;
+
+		//uHTR channel data flavor of QIE11 (HB/HE) frames, as in HcalUnpacker::unpackUTCA (QIE10 uses 0 and 1, QIE8 uses 5)
+		static constexpr int kFlavorQIE11 = 0x2;
+		//scratch space for one frame in raw mode
+		std::vector<uint16_t> frameWords_;
+
+		//output channels (SoA, reused between events)
+		std::vector<HcalDetId> ids_;
+		std::vector<float> energies_;
+		//input shard and row of each output channel (kSuppressed if the channel was not sent)
+		static constexpr unsigned kSuppressed = ~0u;
+		std::vector<unsigned> rows_;
+		std::vector<unsigned> shardOf_;
+		//rows filled in each shard
+		std::vector<unsigned> nrows_;
+		//shard for each (subdetector, |ieta|)
+		static constexpr unsigned kNSubdet = 4;
+		static constexpr unsigned kNIeta = 30;
+		std::vector<int> shardMap_;
+		const HcalTopology* topo_ = nullptr;
 		
 		float depth, ieta, iphi; 
 
@@ -290,10 +515,9 @@ class HcalPhase1Reconstructor_FACILE : public SonicEDProducer<Client>
 };
 
 
-typedef HcalPhase1Reconstructor_FACILE<TRTClientSync> HcalPhase1Reconstructor_FACILESync;
-typedef HcalPhase1Reconstructor_FACILE<TRTClientAsync> HcalPhase1Reconstructor_FACILEAsync;
-typedef HcalPhase1Reconstructor_FACILE<TRTClientPseudoAsync> HcalPhase1Reconstructor_FACILEPseudoAsync;
+//the client mode is selected by the "mode" parameter of the Client PSet
+typedef HcalPhase1Reconstructor_FACILET<TRTClient> HcalPhase1Reconstructor_FACILE;
+typedef HcalPhase1Reconstructor_FACILET<SonicClientSharded<TRTClient>> HcalPhase1Reconstructor_FACILEShards;
 
-DEFINE_FWK_MODULE(HcalPhase1Reconstructor_FACILESync);
-DEFINE_FWK_MODULE(HcalPhase1Reconstructor_FACILEAsync);
-DEFINE_FWK_MODULE(HcalPhase1Reconstructor_FACILEPseudoAsync);
+DEFINE_FWK_MODULE(HcalPhase1Reconstructor_FACILE);
+DEFINE_FWK_MODULE(HcalPhase1Reconstructor_FACILEShards);
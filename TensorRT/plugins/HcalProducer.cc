@@ -18,7 +18,9 @@
 #include "FWCore/Framework/interface/ConsumesCollector.h"
 
 #include "SonicCMS/Core/interface/SonicEDProducer.h"
+#include "SonicCMS/Core/interface/SonicLog.h"
 #include "SonicCMS/TensorRT/interface/TRTClient.h"
+#include "SonicCMS/TensorRT/interface/HcalFeatureSchema.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Framework/interface/EventSetup.h"
@@ -29,13 +31,14 @@
 #include "FWCore/Framework/interface/stream/EDProducer.h"
 
 template <typename Client>
-class HcalProducer : public SonicEDProducer<Client>
+class HcalProducerT : public SonicEDProducer<Client>
 {
 	public:
 		//needed because base class has dependent scope
 		using typename SonicEDProducer<Client>::Input;
 		using typename SonicEDProducer<Client>::Output;
-		explicit HcalProducer(edm::ParameterSet const& cfg) : 
+		typedef HcalProducerFeatures::Schema Schema;
+		explicit HcalProducerT(edm::ParameterSet const& cfg) : 
 			SonicEDProducer<Client>(cfg), 
 			topN_(cfg.getParameter<unsigned>("topN")),   
 			fRHName(cfg.getParameter<edm::InputTag>("edmRecHitName")),   
@@ -48,6 +51,7 @@ class HcalProducer : public SonicEDProducer<Client>
 			this->template produces<HBHERecHitCollection>();
 			//for debugging
 			this->setDebugName("HcalProducer");
+			Schema::check(client_.ninput(), "HcalProducer");
 		}
 		void acquire(edm::Event const& iEvent, edm::EventSetup const& iSetup, Input& iInput) override {
 
@@ -61,7 +65,7 @@ class HcalProducer : public SonicEDProducer<Client>
 			auto ninput = client_.ninput();
 			auto batchSize = client_.batchSize();
 			//auto batchSize = std::distance(hRecHitHCAL->begin(), hRecHitHCAL->end());
-			iInput = Input(ninput*batchSize, 0.f);
+			iInput.assign(ninput*batchSize, 0.f);
 			/*for(unsigned ib = 0; ib < batchSize; ib++) { 
 				for(unsigned i0 = 0; i0 < ninput; i0++) { 
 					iInput[ib*ninput+0] = 1; //
@@ -75,36 +79,28 @@ class HcalProducer : public SonicEDProducer<Client>
 			}*/
 			//batchSize == # of RHs in evt
 			//auto batchSize = std::distance(hRecHitHCAL->begin(), hRecHitHCAL->end());
-			std::cout << "# of RHs: " << std::distance(hRecHitHCAL->begin(), hRecHitHCAL->end()) << std::endl;
+			SONIC_LOG("HcalProducer", "# of RHs: {}", std::distance(hRecHitHCAL->begin(), hRecHitHCAL->end()));
 
 			//fill inputs
 			unsigned int ib = 0;
   			for(HBHERecHitCollection::const_iterator itRH = hRecHitHCAL->begin(); itRH != hRecHitHCAL->end(); itRH++) {
 
-				depth = (float)itRH->id().depth();
-				ieta  = (float)itRH->id().ieta();
-				iphi  = (float)itRH->id().iphi();
-
-				//std::cout << sizeof(depth) << std::endl;
-				iInput[ib*ninput+0] = ieta;
-				iInput[ib*ninput+1] = iphi; 
-
-
+				const HcalDetId cell(itRH->id());
+				float* row = Schema::row(iInput, ib);
+				Schema::set<HcalProducerFeatures::Ieta>(row, cell.ieta());
+				Schema::set<HcalProducerFeatures::Iphi>(row, cell.iphi());
 
   				for (HBHEChannelInfoCollection::const_iterator iter = hChannelInfo->begin(); iter != hChannelInfo->end(); iter++) {
     					const HBHEChannelInfo& pChannel(*iter);
     					const HcalDetId        pDetId = pChannel.id();
-    					if(pDetId != itRH->id()) continue; 
-					iInput[ib*ninput+2] = pChannel.tsGain(0);
-					for (unsigned int iTS=0; iTS<8; ++iTS) {
-						iInput[ib*ninput+iTS+3] = (float)pChannel.tsRawCharge(iTS);
+    					if(pDetId != cell) continue; 
+					Schema::set<HcalProducerFeatures::Gain>(row, pChannel.tsGain(0));
+					for (unsigned int iTS=0; iTS<HcalProducerFeatures::Charge::width; ++iTS) {
+						Schema::set<HcalProducerFeatures::Charge>(row, iTS, pChannel.tsRawCharge(iTS));
 					}
 				}
 
-				for(unsigned int d = 0; d < 8; d++){
-					if(depth == (float)d) 	{ iInput[ib*ninput + d + 10] = 1.; }
-					else 			{ iInput[ib*ninput + d + 10] = 0.; }
-				}
+				Schema::encode<HcalProducerFeatures::Depth>(row, cell.depth());
 				ib++;		
 
 
@@ -127,7 +123,7 @@ class HcalProducer : public SonicEDProducer<Client>
 			//findTopN(iOutput);
 			iEvent.put(std::move(out));
 		}
-		~HcalProducer() override {}
+		~HcalProducerT() override {}
 
 	private:
 
@@ -139,8 +135,6 @@ class HcalProducer : public SonicEDProducer<Client>
    		edm::EDGetTokenT<edm::SortedCollection<HBHERecHit,edm::StrictWeakOrdering<HBHERecHit>>> fTokRH;
     		edm::EDGetTokenT<edm::SortedCollection<HBHEChannelInfo,edm::StrictWeakOrdering<HBHEChannelInfo>>> fTokChanInfo;
 
-		float depth, ieta, iphi; 
-
 		using SonicEDProducer<Client>::client_;
 		//Just putting something in for the hell of it
 		void findTopN(const Output& scores) const {
@@ -167,10 +161,7 @@ class HcalProducer : public SonicEDProducer<Client>
 
 };
 
-typedef HcalProducer<TRTClientSync> HcalProducerSync;
-typedef HcalProducer<TRTClientAsync> HcalProducerAsync;
-typedef HcalProducer<TRTClientPseudoAsync> HcalProducerPseudoAsync;
+//the client mode is selected by the "mode" parameter of the Client PSet
+typedef HcalProducerT<TRTClient> HcalProducer;
 
-DEFINE_FWK_MODULE(HcalProducerSync);
-DEFINE_FWK_MODULE(HcalProducerAsync);
-DEFINE_FWK_MODULE(HcalProducerPseudoAsync);
+DEFINE_FWK_MODULE(HcalProducer);
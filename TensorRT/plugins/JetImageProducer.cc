@@ -21,13 +21,13 @@
 #include "DataFormats/ParticleFlowCandidate/interface/PFCandidate.h"
 
 template <typename Client>
-class JetImageProducer : public SonicEDProducer<Client>
+class JetImageProducerT : public SonicEDProducer<Client>
 {
 	public:
 		//needed because base class has dependent scope
 		using typename SonicEDProducer<Client>::Input;
 		using typename SonicEDProducer<Client>::Output;
-		explicit JetImageProducer(edm::ParameterSet const& cfg) :
+		explicit JetImageProducerT(edm::ParameterSet const& cfg) :
 			SonicEDProducer<Client>(cfg),
 			JetTag_(cfg.getParameter<edm::InputTag>("JetTag")),
 			JetTok_(this->template consumes<edm::View<pat::Jet>>(JetTag_)),
@@ -90,7 +90,7 @@ class JetImageProducer : public SonicEDProducer<Client>
 				//////////////////////////////
 			}
 
-			iInput = Input(client_.ninput()*client_.batchSize(),0.f);
+			iInput.assign(client_.ninput()*client_.batchSize(),0.f);
 			for(unsigned i0 = 0; i0 < client_.batchSize(); i0++ ) { 
 				for(unsigned i1 = 0; i1 < client_.ninput(); i1++) {
 					iInput[client_.ninput()*i0+i1] = img[i1];
@@ -101,11 +101,11 @@ class JetImageProducer : public SonicEDProducer<Client>
 			//check the results
 			findTopN(iOutput);
 		}
-		~JetImageProducer() override {}
+		~JetImageProducerT() override {}
 
 	private:
 		using SonicEDProducer<Client>::client_;
-		void findTopN(const std::vector<float>& scores, unsigned n=5) const {
+		void findTopN(const Output& scores, unsigned n=5) const {
 			auto dim = client_.noutput();
 			for(unsigned i0 = 0; i0 < client_.batchSize(); i0++) {
 				//match score to type by index, then put in largest-first map
@@ -134,11 +134,7 @@ class JetImageProducer : public SonicEDProducer<Client>
 		std::vector<std::string> imageList_;
 };
 
-typedef JetImageProducer<TRTClientSync> JetImageProducerSync;
-typedef JetImageProducer<TRTClientAsync> JetImageProducerAsync;
-typedef JetImageProducer<TRTClientPseudoAsync> JetImageProducerPseudoAsync;
-
-DEFINE_FWK_MODULE(JetImageProducerSync);
-DEFINE_FWK_MODULE(JetImageProducerAsync);
-DEFINE_FWK_MODULE(JetImageProducerPseudoAsync);
+//the client mode is selected by the "mode" parameter of the Client PSet
+typedef JetImageProducerT<TRTClient> JetImageProducer;
 
+DEFINE_FWK_MODULE(JetImageProducer);
@@ -8,6 +8,26 @@ options.register("address", "35.226.56.201", VarParsing.multiplicity.singleton,
 options.register("inputfile", "root://cmsxrootd.fnal.gov//store/relval/CMSSW_10_6_0/RelValTTbar_13/GEN-SIM-DIGI-RAW/106X_upgrade2021_realistic_v5_LowSigmaZGTv5-v1/10000/42E44201-9A4C-C74E-838B-2215221081BC.root", VarParsing.multiplicity.singleton, VarParsing.varType.string)
 options.register("port", 8001, VarParsing.multiplicity.singleton, VarParsing.varType.int)
 options.register("timeout", 300, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("transport", "grpc", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("completion", "library", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("completionThreads", 2, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("zeroCopy", True, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("modelversion", -1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("canaryversion", -1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("canaryfraction", 0.0, VarParsing.multiplicity.singleton, VarParsing.varType.float)
+options.register("metricsFile", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("metricsInterval", 30, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("metricsDQM", False, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("allocationBudget", -1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("traceFile", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("logFile", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("logSample", 1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("inflight", False, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("inflightSocket", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("memoryReport", False, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("helperCpus", "", VarParsing.multiplicity.list, VarParsing.varType.int)
+options.register("bufferNodes", "", VarParsing.multiplicity.list, VarParsing.varType.int)
+options.register("numaReport", False, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
 options.register("params", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
 options.register("threads", 1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
 options.register("streams", 0,    VarParsing.multiplicity.singleton, VarParsing.varType.int)
@@ -15,6 +35,13 @@ options.register("batchsize", 16000,    VarParsing.multiplicity.singleton, VarPa
 options.register("modelname","facile_all_v2", VarParsing.multiplicity.singleton, VarParsing.varType.string)
 options.register("mode", "Async", VarParsing.multiplicity.singleton, VarParsing.varType.string)
 options.register("hang", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("unpackRaw", False, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("denseLayout", False, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("shards", False, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("shardmodels", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("shardbatchsizes", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("zeroSuppress", False, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("zsThreshold", 10.0, VarParsing.multiplicity.singleton, VarParsing.varType.float)
 options.parseArguments()
 
 
@@ -26,12 +53,7 @@ if len(options.params)>0:
     print("server = "+options.address+":"+str(options.port))
 
 # check mode
-allowed_modes = {
-      
-    "Async": "HcalPhase1Reconstructor_FACILEAsync",
-    "Sync": "HcalPhase1Reconstructor_FACILESync",
-    "PseudoAsync": "HcalPhase1Reconstructor_FACILEPseudoAsync",
-}
+allowed_modes = ["Async", "Sync", "PseudoAsync"]
 
 from Configuration.StandardSequences.Eras import eras
 #process = cms.Process('HLT',eras.Run3)
@@ -42,24 +64,61 @@ import sys,os
 sys.path.insert(0,os.path.expandvars("$CMSSW_RELEASE_BASE/src/SonicCMS/TensorRT/python"))
 from HLT_cff import process
 
-process.hltHbherecoclient = cms.EDProducer(allowed_modes[options.mode],
+process.hltHbherecoclient = cms.EDProducer("HcalPhase1Reconstructor_FACILEShards" if options.shards else "HcalPhase1Reconstructor_FACILE",
     sipmQTSShift = cms.uint32(0),
     sipmQNTStoSum = cms.uint32(3),
     topN = cms.uint32(5),
     edmRecHitName = cms.InputTag("hbheprereco"),
     edmChanInfoName = cms.InputTag("hbheprereco"),
     digiLabelQIE11 = cms.InputTag("simHcalDigis","HBHEQIE11DigiCollection"),
+    # read QIE11 samples directly from the FED raw data instead of the digis
+    unpackRaw = cms.bool(options.unpackRaw),
+    fedRawDataLabel = cms.InputTag("rawDataCollector"),
+    # fixed-shape input: one row (8 charges + mask) per HB/HE channel
+    denseLayout = cms.bool(options.denseLayout),
+    # channels with total charge above pedestal (fC) below threshold are not sent
+    zeroSuppress = cms.bool(options.zeroSuppress),
+    zsThreshold = cms.double(options.zsThreshold),
+    zsEnergy = cms.double(0.01),
+    zsLocalEnergy = cms.bool(False),
+    # output energy = min(max(model output * energyScale, energyMin), energyMax)
+    energyScale = cms.double(1.0),
+    energyMin = cms.double(0.01),
+    energyMax = cms.double(1000.),
     simHcalDigiName = cms.untracked.InputTag("simHcalDigis","HBHEQIE11DigiCollection"),
     Client = cms.PSet(
-        ninput  = cms.uint32(47),
+        mode = cms.string(options.mode),
+        ninput  = cms.uint32(9 if options.denseLayout else 47),
         noutput = cms.uint32(1),
         batchSize = cms.uint32(options.batchsize),
         address = cms.string(options.address),
         port = cms.uint32(options.port),
         timeout = cms.uint32(options.timeout),
-        modelName = cms.string(options.modelname)
+        transport = cms.string(options.transport),
+        completion = cms.string(options.completion),
+        zeroCopy = cms.bool(options.zeroCopy),
+        modelName = cms.string(options.modelname),
+        # -1 = latest; canaryFraction of the requests go to canaryVersion (which must then be >= 0)
+        modelVersion = cms.int64(options.modelversion),
+        canaryVersion = cms.int64(options.canaryversion),
+        canaryFraction = cms.double(options.canaryfraction),
     )
 )
+
+# send HB and HE/HO channels as separate concurrent requests (optionally to different models)
+if options.shards:
+    if options.mode=="Sync":
+        raise ValueError("shards are sent one after another in Sync mode: use Async or PseudoAsync")
+    _shardmodels = options.shardmodels.split(",") if len(options.shardmodels)>0 else [options.modelname]*2
+    # maximum rows per shard (each shard only sends the rows it fills)
+    _shardbatchsizes = [int(b) for b in options.shardbatchsizes.split(",")] if len(options.shardbatchsizes)>0 else [options.batchsize]*2
+    _client = process.hltHbherecoclient.Client
+    process.hltHbherecoclient.Client = cms.PSet(
+        shards = cms.VPSet(
+            _client.clone(modelName = cms.string(_shardmodels[0]), batchSize = cms.uint32(_shardbatchsizes[0]), subdets = cms.vuint32(1), absIetaMin = cms.uint32(0), absIetaMax = cms.uint32(29)),
+            _client.clone(modelName = cms.string(_shardmodels[1]), batchSize = cms.uint32(_shardbatchsizes[1]), subdets = cms.vuint32(2,3), absIetaMin = cms.uint32(0), absIetaMax = cms.uint32(29)),
+        )
+    )
 # add specific customizations
 _customInfo = {}
 _customInfo['menuType'  ]= "GRun"
@@ -91,6 +150,13 @@ for msg in keep_msgs:
         )
     )
 
+# SONIC messages are formatted off the event threads (optionally to a file, or sampled)
+process.SonicLogService = cms.Service("SonicLogService",
+    fileName = cms.untracked.string(options.logFile),
+    sampleEvery = cms.untracked.uint32(options.logSample),
+    categories = cms.untracked.vstring(keep_msgs),
+)
+
 if options.threads>0:
     if not hasattr(process,"options"):
         process.options = cms.untracked.PSet()
@@ -108,3 +174,57 @@ process.FastTimerService.printEventSummary        = False
 process.FastTimerService.printRunSummary          = False
 process.FastTimerService.printJobSummary          = True
 
+# the asynchronous wait of SONIC modules (between acquire and produce) is not in the FastTimerService summary
+process.SonicTimingService = cms.Service("SonicTimingService")
+
+# export SONIC client metrics to a Prometheus textfile and/or DQM
+if len(options.metricsFile)>0:
+    process.SonicMetricsService = cms.Service("SonicMetricsService",
+        fileName = cms.untracked.string(options.metricsFile),
+        interval = cms.untracked.uint32(options.metricsInterval),
+        allocationBudget = cms.untracked.int32(options.allocationBudget),
+    )
+if options.metricsDQM:
+    if not hasattr(process,"dqmStore"):
+        process.load("DQMServices.Core.DQMStore_cfi")
+    if not hasattr(process,"dqmSaver"):
+        process.load("DQMServices.Components.DQMFileSaver_cfi")
+        process.dqmSaver.workflow = "/SONIC/Metrics/All"
+    process.sonicMetricsHarvester = cms.EDAnalyzer("SonicMetricsHarvester",
+        folder = cms.string("SONIC"),
+    )
+    process.sonicMetrics_step = cms.EndPath(process.sonicMetricsHarvester + process.dqmSaver)
+    if process.schedule is not None:
+        process.schedule.append(process.sonicMetrics_step)
+
+# timeline of SONIC activity and all modules (Chrome trace-event JSON)
+if len(options.traceFile)>0:
+    process.SonicTraceService = cms.Service("SonicTraceService",
+        fileName = cms.untracked.string(options.traceFile),
+        traceModules = cms.untracked.bool(True),
+    )
+
+# dump of the outstanding SONIC requests on SIGUSR1 (to stderr) or on connection to a Unix socket
+if options.inflight or len(options.inflightSocket)>0:
+    process.SonicInflightService = cms.Service("SonicInflightService",
+        signal = cms.untracked.bool(True),
+        socketPath = cms.untracked.string(options.inflightSocket),
+    )
+
+# memory held by SONIC clients and producers, per module, stream, and buffer category (end of job)
+if options.memoryReport:
+    process.SonicMemoryService = cms.Service("SonicMemoryService")
+
+# pin SONIC helper threads to CPUs and allocate the tensor buffers of each stream on a NUMA node (stream i -> bufferNodes[i % n])
+if len(options.helperCpus)>0 or len(options.bufferNodes)>0 or options.numaReport:
+    process.SonicAffinityService = cms.Service("SonicAffinityService",
+        helperCpus = cms.untracked.vuint32(options.helperCpus),
+        bufferNodes = cms.untracked.vint32(options.bufferNodes),
+        report = cms.untracked.bool(options.numaReport),
+    )
+
+# shared completion threads for completion=engine (Async mode, grpc or unix transport)
+if options.completion=="engine":
+    process.SonicAsyncService = cms.Service("SonicAsyncService",
+        threads = cms.untracked.uint32(options.completionThreads),
+    )
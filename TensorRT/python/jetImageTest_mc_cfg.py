@@ -7,6 +7,15 @@ options = VarParsing("analysis")
 options.register("address", "prp-gpu-1.t2.ucsd.edu", VarParsing.multiplicity.singleton, VarParsing.varType.string)
 options.register("port", 8001, VarParsing.multiplicity.singleton, VarParsing.varType.int)
 options.register("timeout", 30, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("transport", "grpc", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("completion", "library", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("completionThreads", 2, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("zeroCopy", True, VarParsing.multiplicity.singleton, VarParsing.varType.bool)
+options.register("modelversion", -1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("canaryversion", -1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
+options.register("canaryfraction", 0.0, VarParsing.multiplicity.singleton, VarParsing.varType.float)
+options.register("logFile", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
+options.register("logSample", 1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
 options.register("params", "", VarParsing.multiplicity.singleton, VarParsing.varType.string)
 options.register("threads", 1, VarParsing.multiplicity.singleton, VarParsing.varType.int)
 options.register("streams", 0,    VarParsing.multiplicity.singleton, VarParsing.varType.int)
@@ -24,11 +33,7 @@ if len(options.params)>0:
     print("server = "+options.address+":"+str(options.port))
 
 # check mode
-allowed_modes = {
-    "Async": "JetImageProducerAsync",
-    "Sync": "JetImageProducerSync",
-    "PseudoAsync": "JetImageProducerPseudoAsync",
-}
+allowed_modes = ["Async", "Sync", "PseudoAsync"]
 if options.mode not in allowed_modes:
     raise ValueError("Unknown mode: "+options.mode)
 
@@ -52,18 +57,26 @@ process.source = cms.Source("PoolSource",
 if len(options.inputFiles)>0: process.source.fileNames = options.inputFiles
 
 ################### EDProducer ##############################
-process.jetImageProducer = cms.EDProducer(allowed_modes[options.mode],
+process.jetImageProducer = cms.EDProducer("JetImageProducer",
     JetTag = cms.InputTag('slimmedJetsAK8'),
     topN = cms.uint32(5),
     imageList = cms.string("../../Core/data/imagenet_classes.txt"),
     Client = cms.PSet(
+        mode = cms.string(options.mode),
         ninput  = cms.uint32(15),
         noutput = cms.uint32(1),
         batchSize = cms.uint32(options.batchsize),
         address = cms.string(options.address),
         port = cms.uint32(options.port),
         timeout = cms.uint32(options.timeout),
+        transport = cms.string(options.transport),
+        completion = cms.string(options.completion),
+        zeroCopy = cms.bool(options.zeroCopy),
         modelName = cms.string(options.modelname),
+        # -1 = latest; canaryFraction of the requests go to canaryVersion (if >= 0)
+        modelVersion = cms.int64(options.modelversion),
+        canaryVersion = cms.int64(options.canaryversion),
+        canaryFraction = cms.double(options.canaryfraction),
     )
 )
 
@@ -83,8 +96,21 @@ for msg in keep_msgs:
         )
     )
 
+# SONIC messages are formatted off the event threads (optionally to a file, or sampled)
+process.SonicLogService = cms.Service("SonicLogService",
+    fileName = cms.untracked.string(options.logFile),
+    sampleEvery = cms.untracked.uint32(options.logSample),
+    categories = cms.untracked.vstring(keep_msgs),
+)
+
 if options.threads>0:
     if not hasattr(process,"options"):
         process.options = cms.untracked.PSet()
     process.options.numberOfThreads = cms.untracked.uint32(options.threads)
     process.options.numberOfStreams = cms.untracked.uint32(options.streams if options.streams>0 else 0)
+
+# shared completion threads for completion=engine (Async mode, grpc or unix transport)
+if options.completion=="engine":
+    process.SonicAsyncService = cms.Service("SonicAsyncService",
+        threads = cms.untracked.uint32(options.completionThreads),
+    )
@@ -46,6 +46,8 @@ make -j $CORES trtis-clients
 cd ../
 cp -r build/install ${LOCAL}/tensorrtis
 cp -r build/protobuf ${LOCAL}/protobuf-trt
+# grpc server libraries for the node-local proxy (sonicProxy)
+cp -r build/grpc ${LOCAL}/grpc-trt
 
 # rename protobuf-trt libraries to avoid collisions
 cd $LOCAL/protobuf-trt/lib64
@@ -83,10 +85,27 @@ cat << 'EOF_TOOLFILE' > protobuf-trt.xml
 </tool>
 EOF_TOOLFILE
 
+cat << 'EOF_TOOLFILE' > grpc-trt.xml
+<tool name="grpc-trt" version="1.19.1">
+  <lib name="grpc++"/>
+  <lib name="grpc"/>
+  <lib name="gpr"/>
+  <lib name="address_sorting"/>
+  <client>
+    <environment name="GRPC_BASE" default="$CMSSW_BASE/work/local/grpc-trt"/>
+    <environment name="INCLUDE" default="$GRPC_BASE/include"/>
+    <environment name="LIBDIR"  default="$GRPC_BASE/lib"/>
+  </client>
+  <use name="protobuf-trt"/>
+</tool>
+EOF_TOOLFILE
+
 mv tensorrt.xml ${CMSSW_BASE}/config/toolbox/${SCRAM_ARCH}/tools/selected/
 mv protobuf-trt.xml ${CMSSW_BASE}/config/toolbox/${SCRAM_ARCH}/tools/selected/
+mv grpc-trt.xml ${CMSSW_BASE}/config/toolbox/${SCRAM_ARCH}/tools/selected/
 scram setup tensorrt
 scram setup protobuf-trt
+scram setup grpc-trt
 
 # remove the huge source code directory and intermediate products that are not needed to run
 if [ -z "$DEBUG" ]; then
@@ -1,5 +1,8 @@
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
 #include "FWCore/Utilities/interface/Exception.h"
+#include "SonicCMS/Core/interface/SonicAffinity.h"
+#include "SonicCMS/Core/interface/SonicAlloc.h"
+#include "SonicCMS/Core/interface/SonicLog.h"
 #include "SonicCMS/TensorRT/interface/TRTClient.h"
 
 #include "request_grpc.h"
@@ -15,27 +18,140 @@ using ModelInfo = std::pair<std::string, int64_t>;
 
 //based on https://github.com/NVIDIA/tensorrt-inference-server/blob/master/src/clients/c++/examples/simple_callback_client.cc
 
-template <typename Client>
-TRTClient<Client>::TRTClient(const edm::ParameterSet &params) : Client(),
-																url_(params.getParameter<std::string>("address") + ":" + std::to_string(params.getParameter<unsigned>("port"))),
+TRTClient::TRTClient(const edm::ParameterSet &params) : SonicClient<SonicNumaVector<float>>(params),
+																transport_(params),
 																timeout_(params.getParameter<unsigned>("timeout")),
 																modelName_(params.getParameter<std::string>("modelName")),
 																batchSize_(params.getParameter<unsigned>("batchSize")),
+																maxBatchSize_(batchSize_),
 																ninput_(params.getParameter<unsigned>("ninput")),
-																noutput_(params.getParameter<unsigned>("noutput"))
+																noutput_(params.getParameter<unsigned>("noutput")),
+																engine_(params.existsAs<std::string>("completion") and params.getParameter<std::string>("completion") == "engine"),
+																zeroCopy_(!params.existsAs<bool>("zeroCopy") or params.getParameter<bool>("zeroCopy")),
+																modelVersion_(params.existsAs<long long>("modelVersion") ? params.getParameter<long long>("modelVersion") : -1),
+																canaryVersion_(params.existsAs<long long>("canaryVersion") ? params.getParameter<long long>("canaryVersion") : -1),
+																canaryFraction_(params.existsAs<double>("canaryFraction") ? params.getParameter<double>("canaryFraction") : 0.),
+																version_(modelVersion_),
+																rng_(params.existsAs<unsigned>("canarySeed") ? params.getParameter<unsigned>("canarySeed") : std::mt19937::default_seed),
+																uniform_(0., 1.)
 {
+	endpoint_ = transport_.url();
+	if (canaryFraction_ < 0. or canaryFraction_ > 1.)
+		throw cms::Exception("Configuration") << "canaryFraction must be in [0,1], got " << canaryFraction_;
+	if (canaryFraction_ > 0. and canaryVersion_ < 0)
+		throw cms::Exception("Configuration") << "canaryFraction = " << canaryFraction_ << " requires canaryVersion to be set";
+	if (engine_ and mode() != SonicMode::Async)
+		throw cms::Exception("Configuration") << "completion = engine is only available in Async mode";
+	if (engine_ and !transport_.supportsEngine())
+		throw cms::Exception("Configuration") << "completion = engine is not available for transport " << transport_.name() << " (allowed: grpc, unix)";
 }
 
-template <typename Client>
-void TRTClient<Client>::setup()
+TRTClient::~TRTClient()
 {
-	auto err = nic::InferGrpcContext::Create(&context_, url_, modelName_, -1, false);
-	if (!err.IsOk())
-		throw cms::Exception("BadGrpc") << "unable to create inference context: " << err;
+	joinInitialize();
+	for (const auto &vs : versionStats_)
+	{
+		const auto &stats = vs.second;
+		edm::LogInfo("TRTClient") << "Model " << modelName_ << " version " << (vs.first < 0 ? std::string("latest") : std::to_string(vs.first)) << ": "
+								  << stats.requests << " requests, " << stats.rows << " rows, "
+								  << "avg remote time " << (stats.requests ? stats.remoteUs / stats.requests : 0) << " usec, "
+								  << "throughput " << (stats.remoteUs ? stats.rows * 1e6 / stats.remoteUs : 0.) << " rows/sec, "
+								  << stats.wireBytes << " bytes on the wire (" << (stats.remoteUs ? stats.wireBytes * 8e-3 / stats.remoteUs : 0.) << " Gbit/s)";
+	}
+}
+
+void TRTClient::initializeImpl()
+{
+	const auto t0 = std::chrono::high_resolution_clock::now();
+	//canary requests create their own contexts when they are first sent
+	selectContexts(modelVersion_);
+	transport_.prepare(maxBatchSize_ * ninput_ * sizeof(float), maxBatchSize_ * noutput_ * sizeof(float));
+	if (engine_)
+		transport_.connect();
+	//start of the server statistics window of the first request (later windows start at the end of the previous request)
+	if (mode() == SonicMode::Async)
+		GetServerSideStatus(&start_status);
+	const auto t1 = std::chrono::high_resolution_clock::now();
+	edm::LogInfo("TRTClient") << "Initialized " << (debugName_.empty() ? std::string("client") : debugName_) << " (" << transport_.name() << " " << transport_.url()
+							  << ", model " << modelName_ << ") in " << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms";
+}
+
+void TRTClient::checkInput(const nic::InferContext &context) const
+{
+	const auto &nicinput = context.Inputs()[0];
+	if (nicinput->DType() != ni::DataType::TYPE_FP32)
+		throw cms::Exception("BadModel") << "model " << modelName_ << " input " << nicinput->Name() << " is not FP32";
+	const int64_t byteSize = nicinput->ByteSize();
+	if (byteSize > 0 and byteSize != int64_t(ninput_ * sizeof(float)))
+		throw cms::Exception("BadModel") << "model " << modelName_ << " input " << nicinput->Name() << " has " << byteSize / sizeof(float) << " entries per row, but client has ninput = " << ninput_;
+}
+
+void TRTClient::selectContexts(int64_t version)
+{
+	//one pair per version, kept for the whole job (each one holds a connection, and a worker thread in the client library)
+	auto &contexts = contexts_[version];
+	if (!contexts.infer)
+	{
+		transport_.createContexts(modelName_, version, &contexts.infer, &contexts.status);
+		checkInput(*contexts.infer);
+	}
+	context_ = contexts.infer.get();
+	server_ctx_ = contexts.status.get();
+}
+
+void TRTClient::selectVersion()
+{
+	version_ = (canaryVersion_ >= 0 and uniform_(rng_) < canaryFraction_) ? canaryVersion_ : modelVersion_;
+}
+
+void TRTClient::recordRemoteTime(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
+{
+	const unsigned long us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	SonicTracer::instance().span("remote", "sonic", SonicTracer::requestTrack(trace_.stream), start, end, trace_, debugName_);
+	auto &stats = versionStats_[version_];
+	++stats.requests;
+	stats.rows += batchSize_;
+	stats.remoteUs += us;
+	stats.wireBytes += request_.wire + response_.wire;
+	metrics().observe(SonicClientMetrics::Remote, us);
+	metrics().transferred(request_.wire + response_.wire, us);
+	SONIC_LOG("TRTClient", "Remote time ({}, version {}): {}", transport_.name().c_str(), version_, us);
+}
+
+void TRTClient::traceServerSide(const ServerSideStats &stats, std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
+{
+	auto &tracer = SonicTracer::instance();
+	if (!tracer.enabled() or stats.request_count != 1)
+		return;
+	//the server clock is not synchronized: center the server span in the remote span, so the remainder is network time
+	const auto remote = end - start;
+	const std::chrono::nanoseconds cumm(stats.cumm_time_ns), queue(stats.queue_time_ns), compute(stats.compute_time_ns);
+	if (cumm > remote)
+		return;
+	const auto t0 = start + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>((remote - cumm) / 2);
+	const auto t1 = t0 + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(queue);
+	const auto t2 = t1 + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(compute);
+	const auto track = SonicTracer::requestTrack(trace_.stream);
+	tracer.span("server queue", "server", track, t0, t1, trace_, debugName_);
+	tracer.span("server compute", "server", track, t1, t2, trace_, debugName_);
+}
+
+void TRTClient::setBatchSize(unsigned bsize)
+{
+	if (bsize > maxBatchSize_)
+		throw cms::Exception("BadBatch") << "requested batch size " << bsize << " exceeds maximum " << maxBatchSize_;
+	batchSize_ = bsize;
+}
 
-	nic::ServerStatusGrpcContext::Create(&server_ctx_, url_, false);
-	if (!err.IsOk())
-		throw cms::Exception("BadServer") << "unable to create server inference context: " << err;
+void TRTClient::setup()
+{
+	//usually already done at beginStream
+	waitInitialized();
+	inflight().set(SonicInflight::Encode);
+	SonicAllocScope allocScope;
+	selectVersion();
+	selectContexts(version_);
+	transport_.prepare(maxBatchSize_ * ninput_ * sizeof(float), maxBatchSize_ * noutput_ * sizeof(float));
 
 	std::unique_ptr<nic::InferContext::Options> options;
 	nic::InferContext::Options::Create(&options);
@@ -43,7 +159,7 @@ void TRTClient<Client>::setup()
 	options->SetBatchSize(batchSize_);
 	for (const auto &output : context_->Outputs())
 	{
-		options->AddRawResult(output);
+		transport_.addOutput(*options, output, batchSize_, noutput_);
 	}
 	context_->SetRunOptions(*options);
 
@@ -52,51 +168,133 @@ void TRTClient<Client>::setup()
 	nicinput_->Reset();
 
 	auto t2 = std::chrono::high_resolution_clock::now();
-	std::vector<int64_t> input_shape;
-	for (unsigned i0 = 0; i0 < batchSize_; i0++)
+	const size_t encodedBytes = engine_ ? encodeRequest() : transport_.setInput(*nicinput_, input_.data(), batchSize_, ninput_);
+	auto t3 = std::chrono::high_resolution_clock::now();
+	const auto encodeTime = std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+	SONIC_LOG("TRTClient", "Image array time: {}", encodeTime);
+	metrics().observe(SonicClientMetrics::Encode, encodeTime);
+	SonicTracer::instance().span("encode", "sonic", SonicTracer::threadTrack(), t2, t3, trace_, debugName_);
+
+	//names and shapes (approximately) besides the tensors; the response has the same size as the raw output
+	const uint64_t metadataBytes = modelName_.size() + nicinput_->Name().size() + 16;
+	request_.raw = batchSize_ * ninput_ * sizeof(float);
+	request_.encoded = encodedBytes;
+	request_.wire = transport_.wireBytes(encodedBytes, metadataBytes);
+	response_.raw = response_.encoded = batchSize_ * noutput_ * sizeof(float);
+	response_.wire = transport_.wireBytes(response_.encoded, metadataBytes);
+	const SonicAllocStats allocStats(allocScope.stats());
+	metrics().sent(request_);
+	metrics().allocated(SonicClientMetrics::Encode, allocStats);
+
+	if (!memTransport_.bound())
 	{
-		float *arr = &(this->input_.data()[i0 * ninput_]);
-		nic::Error err1 = nicinput_->SetRaw(reinterpret_cast<const uint8_t *>(arr), ninput_ * sizeof(float));
+		const std::string module(debugName_.empty() ? "unknown" : debugName_);
+		memTransport_.bind(module, trace_.stream, "transport");
+		memStatus_.bind(module, trace_.stream, "status");
 	}
-	auto t3 = std::chrono::high_resolution_clock::now();
-	edm::LogInfo("TRTClient") << "Image array time: " << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+	//tensors sent by reference are not copied
+	memTransport_.set((engine_ and zeroCopy_ ? 0 : request_.encoded) + response_.encoded + transport_.sharedMemoryBytes());
 }
 
-template <typename Client>
-void TRTClient<Client>::getResults(const std::unique_ptr<nic::InferContext::Result> &result)
+size_t TRTClient::encodeRequest()
+{
+	auto &request = call_.request;
+	const size_t nbytes = batchSize_ * ninput_ * sizeof(float);
+	//the header is only rebuilt when the model version changes (Clear() keeps the allocated fields),
+	//and the tensor field (if used) keeps its capacity between requests
+	if (request.meta_data().input_size() > 0 and request.model_version() != version_)
+		request.Clear();
+	if (request.meta_data().input_size() == 0)
+	{
+		request.set_model_name(modelName_);
+		request.set_model_version(version_);
+		auto *meta = request.mutable_meta_data();
+		meta->add_input()->set_name(nicinput_->Name());
+		for (const auto &output : context_->Outputs())
+			meta->add_output()->set_name(output->Name());
+		if (!zeroCopy_)
+			request.add_raw_input();
+	}
+	auto *meta = request.mutable_meta_data();
+	meta->set_batch_size(batchSize_);
+	meta->mutable_input(0)->set_batch_byte_size(nbytes);
+	if (zeroCopy_)
+	{
+		call_.tensor = input_.data();
+		call_.tensorBytes = nbytes;
+	}
+	else
+		request.mutable_raw_input(0)->assign(reinterpret_cast<const char *>(input_.data()), nbytes);
+	return nbytes;
+}
+
+void TRTClient::getResults(const std::unique_ptr<nic::InferContext::Result> &result)
+{
+	decode([&](unsigned ib) { return transport_.getOutput(*result, ib, noutput_); });
+}
+
+void TRTClient::getResults(TRTAsyncCall &call)
+{
+	//parsing the response is part of decoding
+	decode([&](unsigned ib) { return transport_.getOutput(call.response, ib, noutput_); }, [&]() { transport_.finishCall(call); });
+}
+
+template <typename F, typename P>
+void TRTClient::decode(const F &row, const P &parse)
 {
 	auto t2 = std::chrono::high_resolution_clock::now();
-	this->output_.resize(noutput_ * batchSize_, 0.f);
+	SonicAllocScope allocScope;
+	parse();
+	output_.resize(noutput_ * batchSize_, 0.f);
 	for (unsigned i0 = 0; i0 < batchSize_; i0++)
 	{
-		const uint8_t *r0;
-		size_t content_byte_size;
-		result->GetRaw(i0, &r0, &content_byte_size);
-		const float *lVal = reinterpret_cast<const float *>(r0);
+		const float *lVal = row(i0);
 		for (unsigned i1 = 0; i1 < noutput_; i1++)
-			this->output_[i0 * noutput_ + i1] = lVal[i1]; //This should be replaced with a memcpy
+			output_[i0 * noutput_ + i1] = lVal[i1]; //This should be replaced with a memcpy
 	}
+	const SonicAllocStats allocStats(allocScope.stats());
 	auto t3 = std::chrono::high_resolution_clock::now();
-	edm::LogInfo("TRTClient") << "Output time: " << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+	const auto decodeTime = std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+	SONIC_LOG("TRTClient", "Output time: {}", decodeTime);
+	metrics().observe(SonicClientMetrics::Decode, decodeTime);
+	SonicTracer::instance().span("decode", "sonic", SonicTracer::threadTrack(), t2, t3, trace_, debugName_);
+	metrics().received(response_);
+	metrics().allocated(SonicClientMetrics::Decode, allocStats);
+}
+
+void TRTClient::predictImpl()
+{
+	if (mode() == SonicMode::Async)
+		predictAsync();
+	else
+		predictBlocking();
 }
 
-template <typename Client>
-void TRTClient<Client>::predictImpl()
+void TRTClient::predictBlocking()
 {
 	//common operations first
 	setup();
 	//blocking call
 	auto t2 = std::chrono::high_resolution_clock::now();
 	std::map<std::string, std::unique_ptr<nic::InferContext::Result>> results;
+	SONIC_PROBE(request__send, debugName_.c_str(), trace_.stream, batchSize_, request_.wire);
+	inflight().set(SonicInflight::Remote);
+	SonicAllocScope allocScope;
 	nic::Error err0 = context_->Run(&results);
+	const SonicAllocStats allocStats(allocScope.stats());
 	auto t3 = std::chrono::high_resolution_clock::now();
-	edm::LogInfo("TRTClient") << "Remote time: " << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+	inflight().set(SonicInflight::Decode);
+	//blocking call: request and response messages are built on this thread
+	metrics().allocated(SonicClientMetrics::Remote, allocStats);
+	SONIC_PROBE(callback, debugName_.c_str(), trace_.stream, batchSize_, response_.wire);
+	if (!err0.IsOk())
+		throw cms::Exception("BadGrpc") << "unable to run inference: " << err0;
+	recordRemoteTime(t2, t3);
 	getResults(results.begin()->second);
 }
 
-//specialization for true async
-template <>
-void TRTClientAsync::predictImpl()
+//true async
+void TRTClient::predictAsync()
 {
 	//common operations first
 	try
@@ -110,50 +308,104 @@ void TRTClientAsync::predictImpl()
 	}
 
 	//non-blocking call
-
-	// Get the status of the server prior to the request being made.
-	// std::map<std::string, ni::ModelStatus> start_status;
-	GetServerSideStatus(&start_status);
-
 	auto t2 = std::chrono::high_resolution_clock::now();
+	//everything after the response is received runs as a task in the framework's arena
+	deferCompletion([t2, this]() {
+		auto t3 = tReceived_;
+		SonicTraceScope traceScope("completion", trace_, debugName_);
+
+		// std::map<std::string, ni::ModelStatus> end_status;
+		GetServerSideStatus(&end_status);
+		uint64_t statusBytes = 0;
+		for (const auto *status : {&start_status, &end_status})
+		{
+			for (const auto &ms : *status)
+				statusBytes += ms.first.capacity() + ms.second.SpaceUsedLong();
+		}
+		memStatus_.set(statusBytes);
+
+		recordRemoteTime(t2, t3);
+
+		//check result (exceptions are passed to finish())
+		if (engine_)
+			getResults(call_);
+		else
+		{
+			getResults(asyncResults_.begin()->second);
+			asyncResults_.clear();
+		}
+
+		ServerSideStats stats{};
+		SummarizeServerStats(std::make_pair(modelName_, version_), start_status, end_status, &stats);
+		//the status at the end of this request starts the window of the next one,
+		//so no status request is sent on the acquire thread before each request
+		start_status.swap(end_status);
+		ReportServerSideState(stats);
+		traceServerSide(stats, t2, t3);
+		//averages if other requests for the same model were processed in the meantime
+		if (stats.request_count > 0)
+		{
+			serverTime_.valid = true;
+			serverTime_.queueUs = stats.queue_time_ns * 1e-3 / stats.request_count;
+			serverTime_.computeUs = stats.compute_time_ns * 1e-3 / stats.request_count;
+		}
+
+		//finish (the client may be reused as soon as the holder is released)
+		finish();
+	});
+	SONIC_PROBE(request__send, debugName_.c_str(), trace_.stream, batchSize_, request_.wire);
+	inflight().set(SonicInflight::Remote);
+	if (engine_)
+	{
+		if (!call_.done)
+		{
+			//runs on a thread of the shared completion engine
+			call_.done = [this](bool ok) {
+				auto tcb = std::chrono::high_resolution_clock::now();
+				SONIC_PROBE(callback, debugName_.c_str(), trace_.stream, batchSize_, response_.wire);
+				inflight().set(SonicInflight::Decode);
+				tReceived_ = tcb;
+				SonicTracer::instance().span("callback", "sonic", SonicTracer::threadTrack(), tcb, std::chrono::high_resolution_clock::now(), trace_, debugName_);
+				if (!ok)
+					complete(tcb, std::make_exception_ptr(cms::Exception("BadCallback") << "completion engine shut down before the request finished"));
+				else
+					complete(tcb);
+			};
+		}
+		transport_.startCall(call_, timeout_);
+		return;
+	}
 	nic::Error erro0 = context_->AsyncRun(
-		[t2, this](nic::InferContext *ctx, const std::shared_ptr<nic::InferContext::Request> &request) {
-			//get results
-			std::map<std::string, std::unique_ptr<nic::InferContext::Result>> results;
+		[this](nic::InferContext *ctx, const std::shared_ptr<nic::InferContext::Request> &request) {
+			//only the response is retrieved on the callback thread
+			auto tcb = std::chrono::high_resolution_clock::now();
+			//the client library creates its own threads, so they are pinned on their first callback
+			SonicAffinity::instance().pinHelperThread();
+			SONIC_PROBE(callback, debugName_.c_str(), trace_.stream, batchSize_, response_.wire);
+			inflight().set(SonicInflight::Decode);
+			tReceived_ = tcb;
+			asyncResults_.clear();
 			//this function interface will change in the next tensorrtis version
 			bool is_ready = false;
-			ctx->GetAsyncRunResults(&results, &is_ready, request, false);
+			ctx->GetAsyncRunResults(&asyncResults_, &is_ready, request, false);
+			SonicTracer::instance().span("callback", "sonic", SonicTracer::threadTrack(), tcb, std::chrono::high_resolution_clock::now(), trace_, debugName_);
 			if (is_ready == false)
-				finish(std::make_exception_ptr(cms::Exception("BadCallback") << "Callback executed before request was ready"));
-
-			auto t3 = std::chrono::high_resolution_clock::now();
-
-			// std::map<std::string, ni::ModelStatus> end_status;
-			GetServerSideStatus(&end_status);
-
-			edm::LogInfo("TRTClient") << "Remote time: " << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
-
-			//check result
-			this->getResults(results.begin()->second);
-
-			ServerSideStats stats;
-			SummarizeServerStats(std::make_pair(modelName_, -1), start_status, end_status, &stats);
-			ReportServerSideState(stats);
-
-			//finish
-			this->finish();
+				complete(tcb, std::make_exception_ptr(cms::Exception("BadCallback") << "Callback executed before request was ready"));
+			else
+				complete(tcb);
 		});
+	if (!erro0.IsOk())
+		cancelCompletion(std::make_exception_ptr(cms::Exception("BadGrpc") << "unable to send request: " << erro0));
 }
 
-template <typename Client>
 void
-TRTClient<Client>::ReportServerSideState(const ServerSideStats& stats)
+TRTClient::ReportServerSideState(const ServerSideStats& stats)
 {
 	// https://github.com/NVIDIA/tensorrt-inference-server/blob/master/src/clients/c%2B%2B/perf_client/inference_profiler.cc
 	const uint64_t cnt = stats.request_count;
 	if (cnt == 0)
 	{
-		std::cout << "  Request count: " << cnt << std::endl;
+		SONIC_LOG("TRTClient", "Request count: {}", cnt);
 		return;
 	}
 
@@ -169,27 +421,25 @@ TRTClient<Client>::ReportServerSideState(const ServerSideStats& stats)
 	const uint64_t overhead = (cumm_avg_us > queue_avg_us + compute_avg_us)
 								  ? (cumm_avg_us - queue_avg_us - compute_avg_us)
 								  : 0;
-	std::cout << "  Request count: " << cnt << std::endl
-			  << "  Avg request latency: " << cumm_avg_us << " usec";
-
-	std::cout << " (overhead " << overhead << " usec + "
-				<< "queue " << queue_avg_us << " usec + "
-				<< "compute " << compute_avg_us << " usec)" << std::endl
-				<< std::endl;
+	SONIC_LOG("TRTClient", "Request count: {}, avg request latency: {} usec (overhead {} usec + queue {} usec + compute {} usec)",
+		cnt, cumm_avg_us, overhead, queue_avg_us, compute_avg_us);
 }
 
-template <typename Client>
 void
-TRTClient<Client>::SummarizeServerStats(
+TRTClient::SummarizeServerStats(
     const ModelInfo model_info,
     const std::map<std::string, ni::ModelStatus>& start_status,
     const std::map<std::string, ni::ModelStatus>& end_status,
     ServerSideStats* server_stats)
 {
-  	SummarizeServerModelStats(
+  const auto start_itr = start_status.find(model_info.first);
+  const auto end_itr = end_status.find(model_info.first);
+  // No statistics if a status request failed
+  if (start_itr == start_status.end() or end_itr == end_status.end())
+    return;
+  SummarizeServerModelStats(
       model_info.first, model_info.second,
-      start_status.find(model_info.first)->second,
-      end_status.find(model_info.first)->second, server_stats);
+      start_itr->second, end_itr->second, server_stats);
 
 //   // Summarize the composing models, if any.
 //   for (const auto& composing_model_info : composing_models_map_[model_info]) {
@@ -210,9 +460,8 @@ TRTClient<Client>::SummarizeServerStats(
 //   return nic::Error::Success;
 }
 
-template <typename Client>
 void
-TRTClient<Client>::SummarizeServerModelStats(
+TRTClient::SummarizeServerModelStats(
     const std::string& model_name, const int64_t model_version,
     const ni::ModelStatus& start_status, const ni::ModelStatus& end_status,
     ServerSideStats* server_stats)
@@ -267,9 +516,8 @@ TRTClient<Client>::SummarizeServerModelStats(
   }
 }
 
-template <typename Client>
 void
-TRTClient<Client>::GetServerSideStatus(
+TRTClient::GetServerSideStatus(
     std::map<std::string, ni::ModelStatus>* model_status)
 {
   model_status->clear();
@@ -277,13 +525,12 @@ TRTClient<Client>::GetServerSideStatus(
   ni::ServerStatus server_status;
   server_ctx_->GetServerStatus(&server_status);
   GetServerSideStatus(
-      server_status, std::make_pair(modelName_, -1), // HARDCODED model_version_ = -1
+      server_status, std::make_pair(modelName_, version_),
       model_status);
 }
 
-template <typename Client>
 void
-TRTClient<Client>::GetServerSideStatus(
+TRTClient::GetServerSideStatus(
     ni::ServerStatus& server_status, const ModelInfo model_info,
     std::map<std::string, ni::ModelStatus>* model_status)
 {
@@ -313,9 +560,3 @@ TRTClient<Client>::GetServerSideStatus(
 //       }
 //     }
 }
-
-//explicit template instantiations
-template class TRTClient<SonicClientSync<std::vector<float>>>;
-template class TRTClient<SonicClientAsync<std::vector<float>>>;
-template class TRTClient<SonicClientPseudoAsync<std::vector<float>>>;
-
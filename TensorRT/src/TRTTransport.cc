@@ -0,0 +1,291 @@
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "SonicCMS/TensorRT/interface/TRTTransport.h"
+
+#include "request_grpc.h"
+#include "request_http.h"
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace nic = nvidia::inferenceserver::client;
+
+TRTTransport::TRTTransport(const edm::ParameterSet &params) :
+	name_(params.existsAs<std::string>("transport") ? params.getParameter<std::string>("transport") : "grpc"),
+	shmRegion_(nullptr),
+	inputBytes_(0),
+	outputBytes_(0)
+{
+	const std::string address(params.getParameter<std::string>("address"));
+	const std::string hostport(address + ":" + std::to_string(params.getParameter<unsigned>("port")));
+	if (name_ == "grpc")
+	{
+		type_ = Type::Grpc;
+		url_ = hostport;
+	}
+	else if (name_ == "grpcStream")
+	{
+		type_ = Type::GrpcStream;
+		url_ = hostport;
+	}
+	else if (name_ == "http")
+	{
+		type_ = Type::Http;
+		url_ = hostport;
+	}
+	else if (name_ == "unix")
+	{
+		type_ = Type::Unix;
+		url_ = address.compare(0, 5, "unix:") == 0 ? address : "unix:" + address;
+	}
+	else if (name_ == "shm")
+	{
+		type_ = Type::SharedMemory;
+		//a node-local proxy can also be reached over a Unix socket
+		url_ = address.compare(0, 5, "unix:") == 0 ? address : hostport;
+		//unique per client within the node
+		static std::atomic<unsigned> counter{0};
+		shmKey_ = "/sonic_" + std::to_string(::getpid()) + "_" + std::to_string(counter++);
+	}
+	else if (name_ == "inprocess")
+		throw cms::Exception("BadTransport") << "transport " << name_ << " is not supported by the TensorRT inference server client library";
+	else
+		throw cms::Exception("BadTransport") << "unknown transport " << name_ << " (allowed: grpc, grpcStream, http, unix, shm)";
+}
+
+TRTTransport::~TRTTransport()
+{
+	releaseSharedMemory();
+}
+
+void TRTTransport::createContexts(const std::string &modelName, int64_t modelVersion, std::unique_ptr<nic::InferContext> *context, std::unique_ptr<nic::ServerStatusContext> *serverContext) const
+{
+	nic::Error err = nic::Error::Success;
+	if (type_ == Type::Http)
+		err = nic::InferHttpContext::Create(context, url_, modelName, modelVersion, false);
+	else if (type_ == Type::GrpcStream)
+		err = nic::InferGrpcStreamContext::Create(context, url_, modelName, modelVersion, false);
+	else
+		err = nic::InferGrpcContext::Create(context, url_, modelName, modelVersion, false);
+	if (!err.IsOk())
+		throw cms::Exception("BadGrpc") << "unable to create inference context (" << name_ << " " << url_ << "): " << err;
+
+	if (type_ == Type::Http)
+		err = nic::ServerStatusHttpContext::Create(serverContext, url_, false);
+	else
+		err = nic::ServerStatusGrpcContext::Create(serverContext, url_, false);
+	if (!err.IsOk())
+		throw cms::Exception("BadServer") << "unable to create server inference context (" << name_ << " " << url_ << "): " << err;
+}
+
+void TRTTransport::prepare(size_t inputBytes, size_t outputBytes)
+{
+	if (type_ != Type::SharedMemory)
+		return;
+	if (shmRegion_ and inputBytes <= inputBytes_ and outputBytes <= outputBytes_)
+		return;
+	releaseSharedMemory();
+
+	const size_t nbytes = inputBytes + outputBytes;
+	int fd = ::shm_open(shmKey_.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		throw cms::Exception("BadTransport") << "unable to open shared memory region " << shmKey_ << ": " << std::strerror(errno);
+	if (::ftruncate(fd, nbytes) != 0)
+	{
+		::close(fd);
+		throw cms::Exception("BadTransport") << "unable to size shared memory region " << shmKey_ << " to " << nbytes << " bytes: " << std::strerror(errno);
+	}
+	void *addr = ::mmap(nullptr, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (addr == MAP_FAILED)
+		throw cms::Exception("BadTransport") << "unable to map shared memory region " << shmKey_ << ": " << std::strerror(errno);
+	shmRegion_ = static_cast<uint8_t *>(addr);
+	inputBytes_ = inputBytes;
+	outputBytes_ = outputBytes;
+
+	//the server maps the same region (it must run on this node)
+	auto err = nic::SharedMemoryControlGrpcContext::Create(&shmContext_, url_, false);
+	if (!err.IsOk())
+		throw cms::Exception("BadTransport") << "unable to create shared memory control context: " << err;
+	err = shmContext_->RegisterSharedMemory(shmKey_.substr(1), shmKey_, 0, nbytes);
+	if (!err.IsOk())
+		throw cms::Exception("BadTransport") << "unable to register shared memory region " << shmKey_ << ": " << err;
+	edm::LogInfo("TRTClient") << "Registered shared memory region " << shmKey_ << " (" << nbytes << " bytes)";
+}
+
+void TRTTransport::releaseSharedMemory()
+{
+	if (!shmRegion_)
+		return;
+	//failures are not fatal here: the region is also removed when the server restarts
+	if (shmContext_)
+		shmContext_->UnregisterSharedMemory(shmKey_.substr(1));
+	::munmap(shmRegion_, inputBytes_ + outputBytes_);
+	::shm_unlink(shmKey_.c_str());
+	shmRegion_ = nullptr;
+	inputBytes_ = outputBytes_ = 0;
+}
+
+size_t TRTTransport::setInput(nic::InferContext::Input &input, const float *data, unsigned batchSize, unsigned rowSize)
+{
+	const size_t rowBytes = rowSize * sizeof(float);
+	const size_t nbytes = batchSize * rowBytes;
+	nic::Error err = nic::Error::Success;
+	if (type_ == Type::SharedMemory)
+	{
+		//one contiguous block for the whole batch
+		if (nbytes > inputBytes_)
+			throw cms::Exception("BadInput") << "input of " << nbytes << " bytes exceeds shared memory region size " << inputBytes_;
+		std::memcpy(shmRegion_, data, nbytes);
+		err = input.SetSharedMemory(shmKey_.substr(1), 0, nbytes);
+	}
+	else
+	{
+		for (unsigned ib = 0; ib < batchSize and err.IsOk(); ++ib)
+			err = input.SetRaw(reinterpret_cast<const uint8_t *>(data + ib * rowSize), rowBytes);
+	}
+	if (!err.IsOk())
+		throw cms::Exception("BadInput") << "unable to set input " << input.Name() << " (" << name_ << "): " << err;
+	//FP32 rows are sent as they are
+	return nbytes;
+}
+
+void TRTTransport::addOutput(nic::InferContext::Options &options, const std::shared_ptr<nic::InferContext::Output> &output, unsigned batchSize, unsigned rowSize) const
+{
+	nic::Error err = nic::Error::Success;
+	if (type_ == Type::SharedMemory)
+		err = options.AddSharedMemoryResult(output, shmKey_.substr(1), inputBytes_, batchSize * rowSize * sizeof(float));
+	else
+		err = options.AddRawResult(output);
+	if (!err.IsOk())
+		throw cms::Exception("BadOutput") << "unable to request output " << output->Name() << " (" << name_ << "): " << err;
+}
+
+const float *TRTTransport::getOutput(nic::InferContext::Result &result, unsigned ib, unsigned rowSize) const
+{
+	if (type_ == Type::SharedMemory)
+		return reinterpret_cast<const float *>(shmRegion_ + inputBytes_) + ib * rowSize;
+
+	const uint8_t *r0;
+	size_t content_byte_size;
+	auto err = result.GetRaw(ib, &r0, &content_byte_size);
+	if (!err.IsOk())
+		throw cms::Exception("BadOutput") << "unable to get output for batch entry " << ib << " (" << name_ << "): " << err;
+	return reinterpret_cast<const float *>(r0);
+}
+
+void TRTTransport::connect()
+{
+	if (stub_)
+		return;
+	//clients initialize concurrently
+	static std::mutex mutex;
+	static std::map<std::string, std::shared_ptr<grpc::Channel>> channels;
+	std::shared_ptr<grpc::Channel> channel;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto &cached = channels[url_];
+		if (!cached)
+		{
+			grpc::ChannelArguments args;
+			args.SetMaxSendMessageSize(-1);
+			args.SetMaxReceiveMessageSize(-1);
+			cached = grpc::CreateCustomChannel(url_, grpc::InsecureChannelCredentials(), args);
+		}
+		channel = cached;
+	}
+	//connect now rather than on the first request (failures are reported by the first request)
+	channel->WaitForConnected(std::chrono::system_clock::now() + std::chrono::seconds(10));
+	//the generic stub sends serialized messages, so the request can be assembled from slices
+	stub_ = std::make_unique<grpc::GenericStub>(channel);
+}
+
+void TRTTransport::startCall(TRTAsyncCall &call, unsigned timeout)
+{
+	connect();
+	call.context = std::make_unique<grpc::ClientContext>();
+	if (timeout > 0)
+		call.context->set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(timeout));
+
+	//the tensor (if sent by reference) is appended to the header as the raw_input field, which is valid since protobuf fields can come in any order
+	if (call.tensor)
+	{
+		call.header.clear();
+		call.request.AppendToString(&call.header);
+		auto appendVarint = [&call](uint64_t value) {
+			for (; value >= 0x80; value >>= 7)
+				call.header.push_back(char(value | 0x80));
+			call.header.push_back(char(value));
+		};
+		appendVarint((ni::InferRequest::kRawInputFieldNumber << 3) | 2);
+		appendVarint(call.tensorBytes);
+		//not owned: the header and the producer's input are not modified until the request is finished
+		auto unowned = [](void *) {};
+		grpc::Slice slices[2] = {grpc::Slice(&call.header[0], call.header.size(), unowned), grpc::Slice(const_cast<void *>(call.tensor), call.tensorBytes, unowned)};
+		call.sendBuffer = grpc::ByteBuffer(slices, 2);
+	}
+	else
+	{
+		//the buffer of the previous request must be released first (the serializer only writes into an empty buffer)
+		call.sendBuffer.Clear();
+		bool owned;
+		grpc::SerializationTraits<ni::InferRequest>::Serialize(call.request, &call.sendBuffer, &owned);
+	}
+
+	call.reader = stub_->PrepareUnaryCall(call.context.get(), "/nvidia.inferenceserver.GRPCService/Infer", call.sendBuffer, &TRTAsyncEngine::instance().queue());
+	call.reader->StartCall();
+	call.reader->Finish(&call.receiveBuffer, &call.status, &call);
+}
+
+void TRTTransport::finishCall(TRTAsyncCall &call) const
+{
+	if (!call.status.ok())
+		throw cms::Exception("BadGrpc") << "unable to run inference (" << name_ << " " << url_ << "): " << call.status.error_message();
+	//parsed into the same message every time, so the output strings keep their capacity
+	auto status = grpc::SerializationTraits<ni::InferResponse>::Deserialize(&call.receiveBuffer, &call.response);
+	if (!status.ok())
+		throw cms::Exception("BadOutput") << "unable to parse response (" << name_ << "): " << status.error_message();
+	if (call.response.request_status().code() != ni::RequestStatusCode::SUCCESS)
+		throw cms::Exception("BadGrpc") << "inference failed (" << name_ << " " << url_ << "): " << call.response.request_status().msg();
+}
+
+const float *TRTTransport::getOutput(const ni::InferResponse &response, unsigned ib, unsigned rowSize) const
+{
+	const size_t rowBytes = rowSize * sizeof(float);
+	if (response.raw_output_size() < 1 or response.raw_output(0).size() < (ib + 1) * rowBytes)
+		throw cms::Exception("BadOutput") << "response has no output for batch entry " << ib << " (" << name_ << ")";
+	return reinterpret_cast<const float *>(response.raw_output(0).data()) + ib * rowSize;
+}
+
+uint64_t TRTTransport::wireBytes(uint64_t tensorBytes, uint64_t metadataBytes) const
+{
+	auto varintSize = [](uint64_t value) {
+		unsigned n = 1;
+		for (; value >= 0x80; value >>= 7)
+			++n;
+		return n;
+	};
+	//tensors in shared memory are not sent
+	if (type_ == Type::SharedMemory)
+		tensorBytes = 0;
+	//binary body, metadata in the request header
+	if (type_ == Type::Http)
+		return tensorBytes + metadataBytes;
+
+	//protobuf: tag and length for the metadata and the (single, concatenated) raw tensor field
+	uint64_t message = metadataBytes + 1 + varintSize(metadataBytes);
+	if (tensorBytes > 0)
+		message += tensorBytes + 1 + varintSize(tensorBytes);
+	//5-byte gRPC message prefix, then 9-byte HTTP/2 frame headers for every 16 kB (default maximum frame size)
+	const uint64_t frameSize = 16384;
+	const uint64_t grpc = message + 5;
+	return grpc + 9 * ((grpc + frameSize - 1) / frameSize);
+}